@@ -0,0 +1,331 @@
+/*=================================================================================================
+  About: Benchmark for the Jump Flooding core in jumpflood.h. It sweeps grid resolutions, seed
+   counts, seed distributions and thread counts, and for every combination times each pass of the
+   algorithm, reporting pixels per second and the memory bandwidth it implies. The results are
+   written as JSON so they can be compared between builds.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "jumpflood.h"
+
+using namespace std;
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Default sweep. Larger grids (up to 16384) and more seeds (up to 1000000) can be requested on
+// the command line, but take much longer.
+#define DEFAULT_RESOLUTIONS   "512,1024,2048,4096"
+#define DEFAULT_SEED_COUNTS   "1,100,10000,100000"
+#define DEFAULT_DISTRIBUTIONS "uniform,clustered,line"
+
+// Default number of executions averaged for each combination
+#define DEFAULT_ITERATIONS 3
+
+/*=================================================================================================
+  STRUCTS
+=================================================================================================*/
+
+// How the seeds are spread over the grid
+enum Distribution {
+	DISTRIBUTION_UNIFORM = 0, // Anywhere, with the same probability
+	DISTRIBUTION_CLUSTERED,   // Gathered in normally distributed clusters
+	DISTRIBUTION_LINE         // Evenly spaced along the diagonal, a hard case for Jump Flooding
+};
+
+// Command line options
+struct Options {
+	vector<int> resolutions;
+	vector<int> seedCounts;
+	vector<int> distributions;
+	vector<int> threadCounts;
+	const char* layout;
+	StepSchedule schedule;
+	int iterations;
+	FILE* output;
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Current time in milliseconds
+double GetClockMsec( void ) {
+
+	struct timeval t;
+	gettimeofday( &t, NULL );
+	return (double)t.tv_sec * 1E+3 + (double)t.tv_usec * 1E-3;
+
+}
+
+const char* DistributionName( int distribution ) {
+
+	switch( distribution ) {
+		case DISTRIBUTION_CLUSTERED: return "clustered";
+		case DISTRIBUTION_LINE:      return "line";
+		default:                     return "uniform";
+	}
+
+}
+
+// Uniform random number in [0,1)
+double RandomUnit( void ) {
+
+	return rand() / ( RAND_MAX + 1.0 );
+
+}
+
+// Places numSeeds seeds over a size x size grid
+void CreateSeeds( int distribution, int numSeeds, int size, vector<Point>& seeds ) {
+
+	seeds.resize( numSeeds );
+
+	// About sqrt(numSeeds) clusters, each with a spread of 2% of the grid
+	int numClusters = (int)sqrt( (double)numSeeds ) + 1;
+	vector<Point> centers( numClusters );
+	for( int i = 0; i < numClusters; ++i ) {
+		centers[i].x = (int)( size * RandomUnit() );
+		centers[i].y = (int)( size * RandomUnit() );
+	}
+
+	for( int i = 0; i < numSeeds; ++i ) {
+
+		Point& p = seeds[i];
+
+		if( distribution == DISTRIBUTION_CLUSTERED ) {
+
+			// Box-Muller transform for normally distributed offsets
+			double radius = sqrt( -2.0 * log( 1.0 - RandomUnit() ) ) * size * 0.02;
+			double angle  = 2.0 * M_PI * RandomUnit();
+
+			const Point& c = centers[ rand() % numClusters ];
+			p.x = c.x + (int)( radius * cos( angle ) );
+			p.y = c.y + (int)( radius * sin( angle ) );
+
+			p.x = p.x < 0 ? 0 : p.x >= size ? size - 1 : p.x;
+			p.y = p.y < 0 ? 0 : p.y >= size ? size - 1 : p.y;
+
+		}
+		else if( distribution == DISTRIBUTION_LINE ) {
+			p.x = (int)( (double)size * i / numSeeds );
+			p.y = p.x;
+		}
+		else {
+			p.x = (int)( size * RandomUnit() );
+			p.y = (int)( size * RandomUnit() );
+		}
+
+	}
+
+}
+
+// Parses a comma separated list of numbers or, if names isn't NULL, of names from that list
+// (given as a function returning the i-th name)
+bool ParseList( const char* text, vector<int>& values, const char* (*names)( int ) = NULL, int numNames = 0 ) {
+
+	values.clear();
+
+	vector<char> copy( text, text + strlen( text ) + 1 );
+	for( char* token = strtok( &copy[0], "," ); token != NULL; token = strtok( NULL, "," ) ) {
+
+		if( names == NULL ) {
+			values.push_back( atoi( token ) );
+			continue;
+		}
+
+		int i = 0;
+		while( i < numNames && strcmp( token, names( i ) ) != 0 )
+			++i;
+
+		if( i == numNames )
+			return false;
+
+		values.push_back( i );
+
+	}
+
+	return values.empty() == false;
+
+}
+
+// Can we hold both buffers of a size x size grid without swapping?
+bool FitsInMemory( int size, size_t cellSize ) {
+
+	double needed = 2.0 * size * size * cellSize;
+	double available = (double)sysconf( _SC_PHYS_PAGES ) * sysconf( _SC_PAGE_SIZE );
+
+	return available <= 0 || needed < 0.75 * available;
+
+}
+
+// Runs every combination of the sweep with one buffer layout, writing a JSON object for each
+template< class Flooder >
+void RunSweep( const Options& opts ) {
+
+	bool first = true;
+	vector<Point> seeds;
+
+	for( size_t r = 0; r < opts.resolutions.size(); ++r ) {
+		for( size_t n = 0; n < opts.seedCounts.size(); ++n ) {
+			for( size_t d = 0; d < opts.distributions.size(); ++d ) {
+				for( size_t t = 0; t < opts.threadCounts.size(); ++t ) {
+
+					int size     = opts.resolutions[r];
+					int numSeeds = opts.seedCounts[n];
+
+					if( size < 1 || numSeeds < 1 || FitsInMemory( size, sizeof( typename Flooder::Cell ) ) == false ) {
+						fprintf( stderr, "Skipping %ix%i with %i seeds.\n", size, size, numSeeds );
+						continue;
+					}
+
+					srand( 1 );
+					CreateSeeds( opts.distributions[d], numSeeds, size, seeds );
+
+					Flooder flooder;
+					flooder.SetNumThreads( opts.threadCounts[t] );
+					flooder.SetSchedule( opts.schedule );
+					flooder.SetPassTiming( true );
+
+					// A first execution allocates and touches the buffers, so it isn't counted
+					if( flooder.Execute( &seeds[0], numSeeds, size, size ) == NULL ) {
+						fprintf( stderr, "Skipping %ix%i with %i seeds, which the layout can't hold.\n", size, size, numSeeds );
+						continue;
+					}
+
+					fprintf( stderr, "%ix%i, %i %s seeds, %i threads...\n", size, size, numSeeds,
+					         DistributionName( opts.distributions[d] ), flooder.NumThreads() );
+
+					vector<double> passTimes( flooder.NumPasses(), 0 );
+					double totalTime = 0;
+
+					for( int i = 0; i < opts.iterations; ++i ) {
+
+						double startTime = GetClockMsec();
+						flooder.Execute( &seeds[0], numSeeds, size, size );
+						totalTime += GetClockMsec() - startTime;
+
+						for( int p = 0; p < flooder.NumPasses(); ++p )
+							passTimes[p] += flooder.PassTime( p );
+
+					}
+
+					// Each pass reads one buffer and writes the other, which is the least
+					// traffic it can cause, so the bandwidth is a lower bound
+					double pixels = (double)size * size;
+					double bytes  = 2.0 * pixels * sizeof( typename Flooder::Cell );
+
+					fprintf( opts.output, "%s\n    {\n", first ? "" : "," );
+					fprintf( opts.output, "      \"width\": %i, \"height\": %i, \"seeds\": %i, \"distribution\": \"%s\",\n",
+					         size, size, numSeeds, DistributionName( opts.distributions[d] ) );
+					fprintf( opts.output, "      \"threads\": %i, \"layout\": \"%s\", \"schedule\": \"%s\", \"kernel\": \"%s\", \"iterations\": %i,\n",
+					         flooder.NumThreads(), opts.layout, StepScheduleName( opts.schedule ),
+					         KernelISAName( flooder.GetKernelISA() ), opts.iterations );
+					fprintf( opts.output, "      \"total_ms\": %.4f, \"pixels_per_sec\": %.6g,\n",
+					         totalTime / opts.iterations, pixels * opts.iterations / ( totalTime * 1E-3 ) );
+					fprintf( opts.output, "      \"passes\": [" );
+
+					for( int p = 0; p < flooder.NumPasses(); ++p ) {
+						double seconds = passTimes[p] / opts.iterations * 1E-3;
+						fprintf( opts.output, "%s\n        { \"step\": %i, \"ms\": %.4f, \"pixels_per_sec\": %.6g, \"bandwidth_gbps\": %.3f }",
+						         p == 0 ? "" : ",", flooder.PassStep( p ), seconds * 1E+3,
+						         seconds > 0 ? pixels / seconds : 0, seconds > 0 ? bytes / seconds * 1E-9 : 0 );
+					}
+
+					fprintf( opts.output, "\n      ]\n    }" );
+					fflush( opts.output );
+					first = false;
+
+				}
+			}
+		}
+	}
+
+}
+
+void PrintUsage( const char* name ) {
+
+	printf( "Usage: %s [-r resolutions] [-n seed counts] [-d uniform,clustered,line] [-t thread counts]\n"
+	        "          [-l point|index32|index16] [-s jfa|jfa+1|jfa+2|1+jfa|jfa^2] [-i iterations] [-o output.json]\n"
+	        "Lists are comma separated, e.g. -r 512,16384 -n 1,1000000 -t 1,0 (0 = one thread per hardware thread).\n", name );
+
+}
+
+// Where it all begins...
+int main( int argc, char **argv ) {
+
+	Options opts;
+	opts.layout     = "point";
+	opts.schedule   = SCHEDULE_JFA;
+	opts.iterations = DEFAULT_ITERATIONS;
+	opts.output     = stdout;
+
+	ParseList( DEFAULT_RESOLUTIONS, opts.resolutions );
+	ParseList( DEFAULT_SEED_COUNTS, opts.seedCounts );
+	ParseList( DEFAULT_DISTRIBUTIONS, opts.distributions, &DistributionName, 3 );
+
+	// One thread and, if there are more, one per hardware thread
+	opts.threadCounts.push_back( 1 );
+	if( sysconf( _SC_NPROCESSORS_ONLN ) > 1 )
+		opts.threadCounts.push_back( 0 );
+
+	// Read options from the command line
+	bool valid = true;
+	int opt;
+	while( valid && ( opt = getopt( argc, argv, "r:n:d:t:l:s:i:o:" ) ) != -1 ) {
+		switch( opt ) {
+			case 'r': valid = ParseList( optarg, opts.resolutions ); break;
+			case 'n': valid = ParseList( optarg, opts.seedCounts ); break;
+			case 'd': valid = ParseList( optarg, opts.distributions, &DistributionName, 3 ); break;
+			case 't': valid = ParseList( optarg, opts.threadCounts ); break;
+			case 'l': opts.layout     = optarg; break;
+			case 's':
+				opts.schedule = FindStepSchedule( optarg );
+				valid = opts.schedule != NUM_SCHEDULES;
+				break;
+			case 'i': opts.iterations = atoi( optarg ); break;
+			case 'o':
+				opts.output = fopen( optarg, "w" );
+				valid = opts.output != NULL;
+				break;
+			default:
+				valid = false;
+		}
+	}
+
+	if( valid == false || opts.iterations < 1 ) {
+		PrintUsage( argv[0] );
+		return 1;
+	}
+
+	fprintf( opts.output, "{\n  \"compiler\": \"%s\",\n  \"results\": [", __VERSION__ );
+
+	// The buffer layout is a template parameter, so pick the matching flooder type
+	if( strcmp( opts.layout, "index32" ) == 0 )
+		RunSweep<IndexJumpFlooder>( opts );
+	else if( strcmp( opts.layout, "index16" ) == 0 )
+		RunSweep<SmallIndexJumpFlooder>( opts );
+	else {
+		opts.layout = "point";
+		RunSweep<JumpFlooder>( opts );
+	}
+
+	fprintf( opts.output, "\n  ]\n}\n" );
+
+	if( opts.output != stdout )
+		fclose( opts.output );
+
+	return 0;
+
+}
@@ -0,0 +1,671 @@
+/*=================================================================================================
+  About: A headless command line front end for the Jump Flooding core in jumpflood.h. It needs no
+   display or OpenGL, so it can be used to run and time the algorithm on servers. Random seeds are
+   placed over a grid of the requested size, the algorithm is executed a number of times on the
+   requested number of threads, and the average time and a checksum of the nearest-seed map are
+   printed. Optionally, the map is checked against the exact closest seeds, and random seeds are
+   moved one at a time with incremental updates, which are timed and compared against a full
+   execution. Seeds can also be loaded from a binary or text file (see seedfile.h), and a batch
+   manifest runs many jobs back to back with the same engine. The area, centroid and bounding box
+   of every seed's cell can be gathered along with the map and saved as CSV. Given a mask image
+   instead, it computes the mask's distance transform.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "jumpflood.h"
+#include "labelmap.h"
+#include "seedfile.h"
+#include "verify.h"
+
+using namespace std;
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Default grid dimensions
+#define DEFAULT_WIDTH  1024
+#define DEFAULT_HEIGHT  768
+
+// Default number of random seeds
+#define DEFAULT_NUM_SEEDS 64
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Current time in milliseconds
+double GetClockMsec( void ) {
+
+	struct timeval t;
+	gettimeofday( &t, NULL );
+	return (double)t.tv_sec * 1E+3 + (double)t.tv_usec * 1E-3;
+
+}
+
+// FNV-1a hash over the coordinates of each pixel's closest seed, so results can be compared
+// between runs, builds and buffer layouts
+template< class Flooder >
+unsigned int Checksum( const Flooder& flooder ) {
+
+	unsigned int hash = 2166136261u;
+
+	for( int y = 0; y < flooder.Height(); ++y ) {
+		for( int x = 0; x < flooder.Width(); ++x ) {
+
+			Point p = flooder.NearestSeed( x, y );
+			const unsigned char* bytes = (const unsigned char*)&p;
+
+			for( size_t i = 0; i < sizeof( Point ); ++i ) {
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+
+		}
+	}
+
+	return hash;
+
+}
+
+// Number of pixels whose closest seeds in a and b are at different distances
+template< class Flooder >
+int CountDifferences( const Flooder& a, const Flooder& b ) {
+
+	int count = 0;
+
+	for( int y = 0; y < a.Height(); ++y ) {
+		for( int x = 0; x < a.Width(); ++x ) {
+
+			Point p = a.NearestSeed( x, y );
+			Point q = b.NearestSeed( x, y );
+
+			if( SquaredDistance( p.x - x, p.y - y ) != SquaredDistance( q.x - x, q.y - y ) )
+				++count;
+
+		}
+	}
+
+	return count;
+
+}
+
+void PrintUsage( const char* name ) {
+
+	printf( "Usage: %s [-w width] [-h height] [-n seeds] [-r random seed] [-i iterations]\n"
+	        "          [-t threads (0 = one per hardware thread)] [-k scalar|sse4.2|avx2|avx512]\n"
+	        "          [-l point|index32|index16] [-T rows|tiled] [-H (use huge pages)]\n"
+	        "          [-o directory (out-of-core buffer files)] [-c memory cap in MiB for -o]\n"
+	        "          [-s jfa|jfa+1|jfa+2|1+jfa|jfa^2] [-m seed moves to update incrementally]\n"
+	        "          [-v (verify against the exact closest seeds)] [-V heatmap.pgm (verify and save the errors)]\n"
+	        "          [-f seeds.bin|.csv (instead of random seeds)] [-S seeds.bin (save the seeds)]\n"
+	        "          [-L labels.raw|.rle|.png (save the label map)] [-C cells.csv (save the cell statistics)]\n"
+	        "       %s -b manifest (lines of: seeds width height [labels.raw|.rle|.png])\n"
+	        "          [-t threads] [-k ...] [-l ...] [-T ...] [-H] [-o ...] [-c ...] [-s ...]\n"
+	        "       %s -M mask.pgm [-D unsigned|signed] [-F float|8|16] [-d max distance] [-O output.pgm|.pfm]\n"
+	        "          [-i iterations] [-t threads] [-k ...] [-l ...] [-T ...] [-H] [-o ...] [-c ...] [-s ...]\n", name, name, name );
+
+}
+
+// Command line options
+struct Options {
+	int width;
+	int height;
+	int numSeeds;
+	int randSeed;
+	int iterations;
+	int numThreads;
+	KernelISA isa;
+	const char* layout;
+	Traversal traversal;
+	bool hugePages;
+	const char* swapDirectory;
+	size_t memoryCap;
+	int numMoves;
+	StepSchedule schedule;
+	bool verify;
+	const char* heatmapFile;
+	const char* maskFile;
+	const char* distanceFile;
+	DistanceMode distanceMode;
+	DistanceFormat distanceFormat;
+	float maxDistance;
+	const char* seedFile;
+	const char* saveSeedFile;
+	const char* batchFile;
+	const char* labelFile;
+	const char* cellsFile;
+};
+
+// Reads an 8-bit binary PGM image. Returns false if it can't be read.
+bool ReadPGM( const char* filename, vector<unsigned char>& pixels, int& width, int& height ) {
+
+	FILE* file = fopen( filename, "rb" );
+	if( file == NULL )
+		return false;
+
+	int maxValue = 0;
+	bool valid = fscanf( file, "P5 %i %i %i", &width, &height, &maxValue ) == 3 &&
+	             width > 0 && height > 0 && maxValue > 0 && maxValue < 256 && fgetc( file ) != EOF;
+
+	if( valid ) {
+		pixels.resize( (size_t)width * height );
+		valid = fread( &pixels[0], 1, pixels.size(), file ) == pixels.size();
+	}
+
+	fclose( file );
+	return valid;
+
+}
+
+// Writes a distance field: quantized ones as 8 or 16-bit PGM images, floats as a PFM image
+bool WriteDistanceField( const char* filename, const vector<unsigned char>& field, int width, int height, DistanceFormat format ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	size_t size = (size_t)width * height;
+	bool valid;
+
+	if( format == DISTANCE_FLOAT ) {
+
+		// PFM stores the rows bottom to top, and a negative scale means little endian
+		fprintf( file, "Pf\n%i %i\n-1.0\n", width, height );
+		valid = true;
+		for( int y = height - 1; y >= 0 && valid; --y )
+			valid = fwrite( &field[ (size_t)y * width * sizeof( float ) ], sizeof( float ), width, file ) == (size_t)width;
+
+	}
+	else if( format == DISTANCE_UINT16 ) {
+
+		// 16-bit PGM values are big endian
+		fprintf( file, "P5\n%i %i\n65535\n", width, height );
+		const unsigned short* values = (const unsigned short*)&field[0];
+		vector<unsigned char> bytes( 2 * size );
+		for( size_t i = 0; i < size; ++i ) {
+			bytes[ 2 * i ]     = values[i] >> 8;
+			bytes[ 2 * i + 1 ] = values[i] & 0xFF;
+		}
+		valid = fwrite( &bytes[0], 1, bytes.size(), file ) == bytes.size();
+
+	}
+	else {
+		fprintf( file, "P5\n%i %i\n255\n", width, height );
+		valid = fwrite( &field[0], 1, size, file ) == size;
+	}
+
+	return fclose( file ) == 0 && valid;
+
+}
+
+// Writes the statistics of each seed's cell as CSV, one line per seed in the order of the seeds.
+// Empty cells have no centroid or bounding box, and leave those fields blank.
+bool WriteCellStats( const char* filename, const CellStats* stats, int numSeeds ) {
+
+	FILE* file = fopen( filename, "w" );
+	if( file == NULL )
+		return false;
+
+	fprintf( file, "seed,area,centroid_x,centroid_y,min_x,min_y,max_x,max_y\n" );
+
+	for( int i = 0; i < numSeeds; ++i ) {
+		const CellStats& s = stats[i];
+		if( s.area > 0 )
+			fprintf( file, "%i,%lli,%.3f,%.3f,%i,%i,%i,%i\n", i, s.area, s.CentroidX(), s.CentroidY(),
+			         s.minX, s.minY, s.maxX, s.maxY );
+		else
+			fprintf( file, "%i,0,,,,,,\n", i );
+	}
+
+	return fclose( file ) == 0;
+
+}
+
+// Applies the options shared by every kind of run to a flooder
+template< class Flooder >
+void Configure( Flooder& flooder, const Options& opts ) {
+
+	flooder.SetNumThreads( opts.numThreads );
+	flooder.SetKernelISA( opts.isa );
+	flooder.SetTraversal( opts.traversal );
+	flooder.SetHugePages( opts.hugePages );
+	flooder.SetOutOfCore( opts.swapDirectory, opts.memoryCap );
+	flooder.SetSchedule( opts.schedule );
+
+}
+
+// Runs the jobs of a batch manifest back to back. Each line holds a seed file, the grid's width and
+// height, and optionally a file for the label map, whose extension picks the format (see
+// labelmap.h). Blank lines and lines starting with '#' are skipped. All the jobs share one
+// flooder, so its threads are started once and its buffers are only reallocated when a job needs
+// a larger grid. Label maps are written in the background while the next job is flooded.
+template< class Flooder >
+int RunBatch( const Options& opts ) {
+
+	FILE* manifest = fopen( opts.batchFile, "r" );
+	if( manifest == NULL ) {
+		printf( "Couldn't read %s.\n", opts.batchFile );
+		return 1;
+	}
+
+	Flooder flooder;
+	Configure( flooder, opts );
+
+	SeedFile seedFile;
+
+	LabelWriter writer;
+	vector<unsigned int> labels;
+	int writingJob = 0;
+	string writingFile;
+
+	char* line = NULL;
+	size_t lineSize = 0;
+	int lineNumber = 0, numJobs = 0, numFailed = 0;
+	double totalTime = 0;
+
+	while( getline( &line, &lineSize, manifest ) != -1 ) {
+
+		++lineNumber;
+
+		vector<char> seedsName( strlen( line ) + 1 ), outputName( strlen( line ) + 1 );
+		int width, height;
+
+		int numFields = sscanf( line, "%s %i %i %s", &seedsName[0], &width, &height, &outputName[0] );
+		if( numFields < 1 || seedsName[0] == '#' )
+			continue;
+
+		++numJobs;
+
+		if( numFields < 3 || width < 1 || height < 1 ) {
+			printf( "Job %i (line %i): expected a seed file, a width and a height.\n", numJobs, lineNumber );
+			++numFailed;
+			continue;
+		}
+
+		if( seedFile.Load( &seedsName[0] ) == false ) {
+			printf( "Job %i: couldn't read the seeds in %s.\n", numJobs, &seedsName[0] );
+			++numFailed;
+			continue;
+		}
+
+		double startTime = GetClockMsec();
+		const typename Flooder::Cell* map = flooder.Execute( seedFile.Seeds(), seedFile.NumSeeds(), width, height );
+		double time = GetClockMsec() - startTime;
+
+		if( map == NULL ) {
+			printf( "Job %i: Jump Flooding failed for the %i seeds in %s.\n", numJobs, seedFile.NumSeeds(), &seedsName[0] );
+			++numFailed;
+			continue;
+		}
+
+		totalTime += time;
+
+		printf( "Job %i: %s | Seeds: %i (%s) | Grid: %ix%i | Time: %.3f ms | Checksum: %08x\n", numJobs,
+		        &seedsName[0], seedFile.NumSeeds(), seedFile.IsMapped() ? "binary" : "text", width, height,
+		        time, Checksum( flooder ) );
+
+		if( numFields < 4 )
+			continue;
+
+		// The labels have to be taken before the next job overwrites the map, but they are
+		// encoded and written while it runs
+		labels.resize( (size_t)width * height );
+		GetLabels( flooder, seedFile.Seeds(), seedFile.NumSeeds(), &labels[0] );
+
+		if( writer.Write( &outputName[0], LabelFormatFromFilename( &outputName[0] ), labels, width, height ) == false ) {
+			printf( "Job %i: couldn't write %s.\n", writingJob, writingFile.c_str() );
+			++numFailed;
+		}
+
+		writingJob  = numJobs;
+		writingFile = &outputName[0];
+
+	}
+
+	if( writingJob > 0 && writer.Wait() == false ) {
+		printf( "Job %i: couldn't write %s.\n", writingJob, writingFile.c_str() );
+		++numFailed;
+	}
+
+	free( line );
+	fclose( manifest );
+
+	printf( "Jobs: %i | Failed: %i | Threads: %i | Kernel: %s | Layout: %s | Schedule: %s | Flooding time: %.3f ms\n",
+	        numJobs, numFailed, flooder.NumThreads(), KernelISAName( flooder.GetKernelISA() ), opts.layout,
+	        StepScheduleName( opts.schedule ), totalTime );
+
+	return numFailed > 0 ? 1 : 0;
+
+}
+
+// Computes the distance transform of the mask with the buffer layout of the given flooder type
+template< class Flooder >
+int RunDistanceTransform( const Options& opts ) {
+
+	vector<unsigned char> mask;
+	int width, height;
+
+	if( ReadPGM( opts.maskFile, mask, width, height ) == false ) {
+		printf( "Couldn't read %s, which must be an 8-bit binary PGM image.\n", opts.maskFile );
+		return 1;
+	}
+
+	Flooder flooder;
+	Configure( flooder, opts );
+
+	size_t valueSize = opts.distanceFormat == DISTANCE_FLOAT ? sizeof( float ) :
+	                   opts.distanceFormat == DISTANCE_UINT16 ? sizeof( unsigned short ) : sizeof( unsigned char );
+	vector<unsigned char> field( (size_t)width * height * valueSize );
+
+	bool done = true;
+
+	double startTime = GetClockMsec();
+	for( int i = 0; i < opts.iterations && done; ++i )
+		done = flooder.DistanceTransform( &mask[0], width, height, opts.distanceMode, opts.distanceFormat,
+		                                  opts.maxDistance, &field[0] );
+	double endTime = GetClockMsec();
+
+	if( done == false ) {
+		printf( "The distance transform failed. Does the mask have a foreground?\n" );
+		return 1;
+	}
+
+	// FNV-1a hash of the distance field
+	unsigned int hash = 2166136261u;
+	for( size_t i = 0; i < field.size(); ++i ) {
+		hash ^= field[i];
+		hash *= 16777619u;
+	}
+
+	printf( "Mask: %ix%i | Iterations: %i | Threads: %i | Kernel: %s | Layout: %s | Schedule: %s\n",
+	        width, height, opts.iterations, flooder.NumThreads(), KernelISAName( flooder.GetKernelISA() ),
+	        opts.layout, StepScheduleName( opts.schedule ) );
+	printf( "Distance field: %s, %s, max distance %g\n", opts.distanceMode == DISTANCE_SIGNED ? "signed" : "unsigned",
+	        opts.distanceFormat == DISTANCE_FLOAT ? "float" : opts.distanceFormat == DISTANCE_UINT16 ? "16-bit" : "8-bit",
+	        opts.maxDistance );
+	printf( "Average time: %.3f ms\n", ( endTime - startTime ) / opts.iterations );
+	printf( "Checksum: %08x\n", hash );
+
+	if( opts.distanceFile != NULL && WriteDistanceField( opts.distanceFile, field, width, height, opts.distanceFormat ) == false ) {
+		printf( "Couldn't write %s.\n", opts.distanceFile );
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Executes the algorithm with the buffer layout of the given flooder type and prints the results
+template< class Flooder >
+int Run( const Options& opts, const Point* seeds, int numSeeds ) {
+
+	if( opts.maskFile != NULL )
+		return RunDistanceTransform<Flooder>( opts );
+
+	if( opts.batchFile != NULL )
+		return RunBatch<Flooder>( opts );
+
+	Flooder flooder;
+	Configure( flooder, opts );
+	flooder.SetCellStats( opts.cellsFile != NULL );
+	const typename Flooder::Cell* map = NULL;
+
+	double startTime = GetClockMsec();
+	for( int i = 0; i < opts.iterations; ++i )
+		map = flooder.Execute( seeds, numSeeds, opts.width, opts.height );
+	double endTime = GetClockMsec();
+
+	if( map == NULL ) {
+		printf( "Jump Flooding failed.\n" );
+		return 1;
+	}
+
+	printf( "Grid: %ix%i | Seeds: %i | Iterations: %i | Threads: %i | Kernel: %s | Layout: %s (%zu bytes/pixel)\n",
+	        opts.width, opts.height, numSeeds, opts.iterations, flooder.NumThreads(),
+	        KernelISAName( flooder.GetKernelISA() ), opts.layout, sizeof( typename Flooder::Cell ) );
+	printf( "Traversal: %s | Huge pages: %s\n", opts.traversal == TRAVERSAL_TILED ? "tiled" : "rows",
+	        opts.hugePages ? "yes" : "no" );
+	if( opts.swapDirectory != NULL )
+		printf( "Out of core: %s | Memory cap: %zu MiB\n", opts.swapDirectory, flooder.GetMemoryCap() >> 20 );
+	int jfaPasses = flooder.NumPasses() - flooder.NumExtraPasses();
+	printf( "Schedule: %s | Passes: %i (%+i over jfa, %+.1f%%)\n", StepScheduleName( opts.schedule ),
+	        flooder.NumPasses(), flooder.NumExtraPasses(),
+	        jfaPasses > 0 ? 100.0 * flooder.NumExtraPasses() / jfaPasses : 0.0 );
+	printf( "Average time: %.3f ms\n", ( endTime - startTime ) / opts.iterations );
+	printf( "Checksum: %08x\n", Checksum( flooder ) );
+
+	if( opts.labelFile != NULL ) {
+
+		vector<unsigned int> labels( (size_t)opts.width * opts.height );
+		GetLabels( flooder, seeds, numSeeds, &labels[0] );
+
+		startTime = GetClockMsec();
+		bool written = WriteLabels( opts.labelFile, LabelFormatFromFilename( opts.labelFile ), &labels[0], opts.width, opts.height );
+		endTime = GetClockMsec();
+
+		if( written == false ) {
+			printf( "Couldn't write %s.\n", opts.labelFile );
+			return 1;
+		}
+
+		printf( "Labels: %s (%s) | Written in %.3f ms\n", opts.labelFile,
+		        LabelFormatName( LabelFormatFromFilename( opts.labelFile ) ), endTime - startTime );
+
+	}
+
+	if( opts.cellsFile != NULL ) {
+
+		const CellStats* stats = flooder.CellStatistics();
+
+		int numCells = 0;
+		for( int i = 0; i < numSeeds; ++i )
+			if( stats[i].area > 0 )
+				++numCells;
+
+		if( WriteCellStats( opts.cellsFile, stats, numSeeds ) == false ) {
+			printf( "Couldn't write %s.\n", opts.cellsFile );
+			return 1;
+		}
+
+		printf( "Cells: %s | Non-empty: %i of %i\n", opts.cellsFile, numCells, numSeeds );
+
+	}
+
+	if( opts.verify ) {
+
+		VerifyStats stats;
+		vector<unsigned char> heatmap( opts.heatmapFile != NULL ? (size_t)opts.width * opts.height : 0 );
+
+		startTime = GetClockMsec();
+		VerifyNearestSeeds( flooder, seeds, numSeeds, opts.numThreads, stats,
+		                    opts.heatmapFile != NULL ? &heatmap[0] : NULL );
+		endTime = GetClockMsec();
+
+		printf( "Misclassified pixels: %lli of %lli (%.4f%%) | Empty pixels: %lli | Pixels without a real seed: %lli | Distance error: %.3f max, %.3f mean | Verified in %.3f ms\n",
+		        stats.numMisclassified, stats.numPixels, 100.0 * stats.numMisclassified / stats.numPixels,
+		        stats.numEmpty, stats.numInvalid, stats.maxError, stats.meanError, endTime - startTime );
+
+		if( opts.heatmapFile != NULL && WriteHeatmap( opts.heatmapFile, &heatmap[0], opts.width, opts.height ) == false ) {
+			printf( "Couldn't write %s.\n", opts.heatmapFile );
+			return 1;
+		}
+
+	}
+
+	if( opts.numMoves < 1 )
+		return 0;
+
+	// Move random seeds to random positions, updating the map incrementally each time. The seeds
+	// may be mapped from a file, so move a copy.
+	vector<Point> moved( seeds, seeds + numSeeds );
+
+	double updateTime = 0;
+	for( int i = 0; i < opts.numMoves; ++i ) {
+
+		int idx = rand() % moved.size();
+		Point from = moved[ idx ];
+		moved[ idx ].x = (int)( (double)opts.width  * ( rand() / ( RAND_MAX + 1.0 ) ) );
+		moved[ idx ].y = (int)( (double)opts.height * ( rand() / ( RAND_MAX + 1.0 ) ) );
+
+		startTime = GetClockMsec();
+		flooder.MoveSeed( &moved[0], moved.size(), idx, from );
+		updateTime += GetClockMsec() - startTime;
+
+	}
+
+	// Compare with the map a full execution gives for the final seeds
+	Flooder reference;
+	reference.SetNumThreads( opts.numThreads );
+	reference.SetSchedule( opts.schedule );
+	reference.Execute( &moved[0], moved.size(), opts.width, opts.height );
+
+	printf( "Seed moves: %i | Average update time: %.3f ms | Pixels differing from a full execution: %i\n",
+	        opts.numMoves, updateTime / opts.numMoves, CountDifferences( flooder, reference ) );
+
+	return 0;
+
+}
+
+// Where it all begins...
+int main( int argc, char **argv ) {
+
+	Options opts;
+	opts.width      = DEFAULT_WIDTH;
+	opts.height     = DEFAULT_HEIGHT;
+	opts.numSeeds   = DEFAULT_NUM_SEEDS;
+	opts.randSeed   = 1;
+	opts.iterations = 1;
+	opts.numThreads = 1;
+	opts.isa        = DetectKernelISA();
+	opts.layout     = "point";
+	opts.traversal  = TRAVERSAL_ROWS;
+	opts.hugePages  = false;
+	opts.swapDirectory = NULL;
+	opts.memoryCap     = 0;
+	opts.numMoves   = 0;
+	opts.schedule   = SCHEDULE_JFA;
+	opts.verify     = false;
+	opts.heatmapFile = NULL;
+	opts.maskFile       = NULL;
+	opts.distanceFile   = NULL;
+	opts.distanceMode   = DISTANCE_UNSIGNED;
+	opts.distanceFormat = DISTANCE_FLOAT;
+	opts.maxDistance    = 32;
+	opts.seedFile       = NULL;
+	opts.saveSeedFile   = NULL;
+	opts.batchFile      = NULL;
+	opts.labelFile      = NULL;
+	opts.cellsFile      = NULL;
+
+	// Read options from the command line
+	int opt;
+	while( ( opt = getopt( argc, argv, "w:h:n:r:i:t:k:l:T:Ho:c:m:s:vV:M:D:F:d:O:f:S:b:L:C:" ) ) != -1 ) {
+		switch( opt ) {
+			case 'w': opts.width      = atoi( optarg ); break;
+			case 'h': opts.height     = atoi( optarg ); break;
+			case 'n': opts.numSeeds   = atoi( optarg ); break;
+			case 'r': opts.randSeed   = atoi( optarg ); break;
+			case 'i': opts.iterations = atoi( optarg ); break;
+			case 't': opts.numThreads = atoi( optarg ); break;
+			case 'l': opts.layout     = optarg; break;
+			case 'T': opts.traversal  = strcmp( optarg, "tiled" ) == 0 ? TRAVERSAL_TILED : TRAVERSAL_ROWS; break;
+			case 'H': opts.hugePages  = true; break;
+			case 'o': opts.swapDirectory = optarg; break;
+			case 'c': opts.memoryCap     = (size_t)atoi( optarg ) << 20; break;
+			case 'm': opts.numMoves   = atoi( optarg ); break;
+			case 's': opts.schedule   = FindStepSchedule( optarg ); break;
+			case 'v': opts.verify     = true; break;
+			case 'V': opts.verify     = true; opts.heatmapFile = optarg; break;
+			case 'M': opts.maskFile     = optarg; break;
+			case 'O': opts.distanceFile = optarg; break;
+			case 'D': opts.distanceMode = strcmp( optarg, "signed" ) == 0 ? DISTANCE_SIGNED : DISTANCE_UNSIGNED; break;
+			case 'F':
+				opts.distanceFormat = strcmp( optarg, "8" ) == 0 ? DISTANCE_UINT8 :
+				                      strcmp( optarg, "16" ) == 0 ? DISTANCE_UINT16 : DISTANCE_FLOAT;
+				break;
+			case 'd': opts.maxDistance = atof( optarg ); break;
+			case 'f': opts.seedFile     = optarg; break;
+			case 'S': opts.saveSeedFile = optarg; break;
+			case 'b': opts.batchFile    = optarg; break;
+			case 'L': opts.labelFile    = optarg; break;
+			case 'C': opts.cellsFile    = optarg; break;
+			case 'k':
+				for( opts.isa = KERNEL_AVX512; opts.isa > KERNEL_SCALAR; opts.isa = (KernelISA)( opts.isa - 1 ) )
+					if( strcmp( optarg, KernelISAName( opts.isa ) ) == 0 )
+						break;
+				break;
+			default:
+				PrintUsage( argv[0] );
+				return 1;
+		}
+	}
+
+	if( opts.width < 1 || opts.height < 1 || opts.numSeeds < 1 || opts.iterations < 1 ||
+	    opts.schedule == NUM_SCHEDULES ) {
+		PrintUsage( argv[0] );
+		return 1;
+	}
+
+	// Load the seeds, or place them randomly over the grid
+	SeedFile seedFile;
+	vector<Point> randomSeeds;
+	const Point* seeds;
+	int numSeeds;
+
+	srand( opts.randSeed );
+
+	if( opts.seedFile != NULL ) {
+
+		if( seedFile.Load( opts.seedFile ) == false || seedFile.NumSeeds() < 1 ) {
+			printf( "Couldn't read any seeds from %s.\n", opts.seedFile );
+			return 1;
+		}
+
+		seeds    = seedFile.Seeds();
+		numSeeds = seedFile.NumSeeds();
+
+	}
+	else {
+
+		randomSeeds.resize( opts.numSeeds );
+		for( int i = 0; i < opts.numSeeds; ++i ) {
+			randomSeeds[i].x = (int)( (double)opts.width  * ( rand() / ( RAND_MAX + 1.0 ) ) );
+			randomSeeds[i].y = (int)( (double)opts.height * ( rand() / ( RAND_MAX + 1.0 ) ) );
+		}
+
+		seeds    = &randomSeeds[0];
+		numSeeds = opts.numSeeds;
+
+	}
+
+	if( opts.saveSeedFile != NULL && WriteSeedFile( opts.saveSeedFile, seeds, numSeeds ) == false ) {
+		printf( "Couldn't write %s.\n", opts.saveSeedFile );
+		return 1;
+	}
+
+	// The buffer layout is a template parameter, so pick the matching flooder type
+	if( strcmp( opts.layout, "point" ) == 0 )
+		return Run<JumpFlooder>( opts, seeds, numSeeds );
+
+	if( strcmp( opts.layout, "index32" ) == 0 )
+		return Run<IndexJumpFlooder>( opts, seeds, numSeeds );
+
+	if( strcmp( opts.layout, "index16" ) == 0 )
+		return Run<SmallIndexJumpFlooder>( opts, seeds, numSeeds );
+
+	PrintUsage( argv[0] );
+	return 1;
+
+}
@@ -0,0 +1,1321 @@
+/*=================================================================================================
+  About: Implementation of the JumpFlooder class declared in jumpflood.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jumpflood.h"
+#include "threadpool.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Number of consecutive rows processed together by the tiled traversal
+#define TILE_BLOCK_ROWS 8
+
+// Bytes of the read buffer the tiled traversal tries to keep in the cache at once
+#define TILE_WORKING_SET ( 1024 * 1024 )
+
+// Cache size assumed when the system can't tell us
+#define DEFAULT_CACHE_SIZE ( 8 * 1024 * 1024 )
+
+// Huge pages are 2 MiB on x86
+#define HUGE_PAGE_SIZE ( 2 * 1024 * 1024 )
+
+// Mask values from this one up are the foreground in distance transforms
+#define MASK_THRESHOLD 128
+
+// Bytes of the buffers mapped in at once in out-of-core mode, unless told otherwise
+#define DEFAULT_MEMORY_CAP ( 256 * 1024 * 1024 )
+
+// Runs of pixels whose cell statistics are fetched together, see AccumulateStats()
+#define STATS_BATCH_RUNS 64
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Allocates a buffer aligned to a cache line or, if hugePages is true, to a huge page, in which
+// case the kernel is asked to back it with transparent huge pages. Release it with free().
+static void* AllocateBuffer( size_t size, bool hugePages ) {
+
+	void* ptr = NULL;
+	size_t alignment = hugePages ? HUGE_PAGE_SIZE : 64;
+
+	if( hugePages )
+		size = ( size + HUGE_PAGE_SIZE - 1 ) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+	if( posix_memalign( &ptr, alignment, size ) != 0 )
+		return NULL;
+
+#ifdef MADV_HUGEPAGE
+	if( hugePages )
+		madvise( ptr, size, MADV_HUGEPAGE );
+#endif
+
+	return ptr;
+
+}
+
+// Maps a buffer of size bytes from a new file in directory. The file is deleted right away, so
+// its space is given back as soon as the buffer is unmapped, even if we crash. Returns NULL if the
+// file can't be created. Release the buffer with munmap().
+static void* MapBuffer( const char* directory, size_t size ) {
+
+	std::string path = std::string( directory ) + "/jfa-XXXXXX";
+
+	int file = mkstemp( &path[0] );
+	if( file == -1 )
+		return NULL;
+
+	unlink( path.c_str() );
+
+	void* ptr = MAP_FAILED;
+	if( ftruncate( file, (off_t)size ) == 0 )
+		ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0 );
+
+	// The mapping keeps the file alive
+	close( file );
+
+	return ptr != MAP_FAILED ? ptr : NULL;
+
+}
+
+// Gives the kernel advice (MADV_WILLNEED or MADV_DONTNEED) about rows [yBegin,yEnd) of a buffer
+// mapped with MapBuffer(), clamped to its height. Rows are widened to whole pages, so parts of the
+// rows around them may be dropped too, but the file keeps their contents and they are simply read
+// back if needed.
+template< class Cell >
+static void AdviseRows( const Cell* buffer, int width, int height, int yBegin, int yEnd, int advice ) {
+
+	yBegin = yBegin < 0 ? 0 : yBegin;
+	yEnd   = yEnd > height ? height : yEnd;
+
+	if( yBegin >= yEnd )
+		return;
+
+	size_t pageSize = (size_t)sysconf( _SC_PAGESIZE );
+	size_t begin = (size_t)( buffer + (size_t)yBegin * width ) / pageSize * pageSize;
+	size_t end   = (size_t)( buffer + (size_t)yEnd * width );
+
+	madvise( (void*)begin, end - begin, advice );
+
+}
+
+// Size of the largest CPU cache in bytes
+static size_t GetLastLevelCacheSize( void ) {
+
+	long size = -1;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	if( size <= 0 )
+		size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+
+	return size > 0 ? (size_t)size : DEFAULT_CACHE_SIZE;
+
+}
+
+// Current time in milliseconds, from a clock that never goes backwards
+static double GetClockMsec( void ) {
+
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (double)t.tv_sec * 1E+3 + (double)t.tv_nsec * 1E-6;
+
+}
+
+// Asks the CPU to start loading cells [xBegin,xEnd) of a row into the cache
+template< class Cell >
+static inline void PrefetchCells( const Cell* row, int xBegin, int xEnd ) {
+
+	const char* begin = (const char*)( row + xBegin );
+	const char* end   = (const char*)( row + xEnd );
+
+	for( const char* p = begin; p < end; p += 64 )
+		__builtin_prefetch( p, 0, 3 );
+
+}
+
+template< class Layout >
+BasicJumpFlooder<Layout>::BasicJumpFlooder( void ) :
+	BufferA( NULL ),
+	BufferB( NULL ),
+	BufferWidth( 0 ),
+	BufferHeight( 0 ),
+	ReadingBufferA( true ),
+	HasResult( false ),
+	BufferCapacity( 0 ),
+	BufferHugePages( false ),
+	BufferMapped( false ),
+	Pool( NULL ),
+	ISA( DetectKernelISA() ),
+	Mode( TRAVERSAL_ROWS ),
+	HugePages( false ),
+	MemoryCap( DEFAULT_MEMORY_CAP ),
+	CacheSize( GetLastLevelCacheSize() ),
+	Schedule( SCHEDULE_JFA ),
+	NumSteps( 0 ),
+	PassTiming( false ),
+	DistanceMask( NULL ),
+	DistanceOutput( NULL ),
+	DistMode( DISTANCE_UNSIGNED ),
+	DistFormat( DISTANCE_FLOAT ),
+	MaxDistance( 1 ),
+	CellStatsEnabled( false ),
+	HasStats( false ) {
+
+	Cells.SetKernelISA( ISA );
+
+}
+
+template< class Layout >
+BasicJumpFlooder<Layout>::~BasicJumpFlooder( void ) {
+
+	Clear();
+
+	delete Pool;
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::SetNumThreads( int numThreads ) {
+
+	delete Pool;
+	Pool = NULL;
+
+	// A single thread doesn't need a pool at all
+	if( numThreads == 1 )
+		return;
+
+	Pool = new ThreadPool( numThreads );
+
+	if( Pool->NumThreads() == 1 ) {
+		delete Pool;
+		Pool = NULL;
+	}
+
+}
+
+template< class Layout >
+int BasicJumpFlooder<Layout>::NumThreads( void ) const {
+
+	return Pool != NULL ? Pool->NumThreads() : 1;
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::SetKernelISA( KernelISA isa ) {
+
+	KernelISA supported = DetectKernelISA();
+
+	ISA = isa > supported ? supported : isa;
+	Cells.SetKernelISA( ISA );
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::SetTraversal( Traversal mode ) {
+
+	Mode = mode;
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::SetHugePages( bool enable ) {
+
+	HugePages = enable;
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::SetOutOfCore( const char* directory, size_t memoryCap ) {
+
+	SwapDirectory = directory != NULL ? directory : "";
+	MemoryCap     = memoryCap > 0 ? memoryCap : DEFAULT_MEMORY_CAP;
+
+}
+
+// Glue between the thread pool, which calls plain functions, and our band functions
+template< class Flooder >
+struct BandTask {
+	Flooder* flooder;
+	void (Flooder::*func)( int, int );
+};
+
+template< class Flooder >
+static void RunBandTask( void* arg, int threadIdx, int numThreads ) {
+
+	BandTask<Flooder>* task = (BandTask<Flooder>*)arg;
+	( task->flooder->*task->func )( threadIdx, numThreads );
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::RunParallel( void (BasicJumpFlooder::*func)( int, int ) ) {
+
+	if( Pool == NULL ) {
+		( this->*func )( 0, 1 );
+		return;
+	}
+
+	BandTask<BasicJumpFlooder> task = { this, func };
+	Pool->Run( &RunBandTask<BasicJumpFlooder>, &task );
+
+}
+
+// Rows [yBegin,yEnd) belonging to a thread. Bands differ in size by at most one row.
+static void GetBand( int height, int threadIdx, int numThreads, int& yBegin, int& yEnd ) {
+
+	yBegin = (int)( (long long)height * threadIdx / numThreads );
+	yEnd   = (int)( (long long)height * ( threadIdx + 1 ) / numThreads );
+
+}
+
+// Adds the pixels of one cell's statistics, which mustn't be empty, to another's
+static void MergeCellStats( CellStats& s, const CellStats& p ) {
+
+	if( s.area == 0 ) {
+		s.minX = p.minX; s.maxX = p.maxX;
+		s.minY = p.minY; s.maxY = p.maxY;
+	}
+	else {
+		s.minX = p.minX < s.minX ? p.minX : s.minX;
+		s.maxX = p.maxX > s.maxX ? p.maxX : s.maxX;
+		s.minY = p.minY < s.minY ? p.minY : s.minY;
+		s.maxY = p.maxY > s.maxY ? p.maxY : s.maxY;
+	}
+
+	s.area += p.area;
+	s.sumX += p.sumX;
+	s.sumY += p.sumY;
+
+}
+
+// If the buffers exist, delete them
+template< class Layout >
+void BasicJumpFlooder<Layout>::Clear( void ) {
+
+	size_t size = sizeof( Cell ) * BufferCapacity;
+
+	if( BufferA != NULL ) {
+		if( BufferMapped )
+			munmap( BufferA, size );
+		else
+			free( BufferA );
+		BufferA = NULL;
+	}
+
+	if( BufferB != NULL ) {
+		if( BufferMapped )
+			munmap( BufferB, size );
+		else
+			free( BufferB );
+		BufferB = NULL;
+	}
+
+	BufferCapacity = 0;
+	HasResult = false;
+	HasStats  = false;
+
+}
+
+// Make sure both buffers can hold numCells cells. They are only reallocated if they are too small
+// or were allocated with a different page size or out-of-core mode, so repeated executions at the
+// same resolution don't touch the heap at all.
+template< class Layout >
+bool BasicJumpFlooder<Layout>::ReserveBuffers( size_t numCells ) {
+
+	bool mapped = SwapDirectory.empty() == false;
+
+	if( BufferA != NULL && numCells <= BufferCapacity && BufferHugePages == HugePages && BufferMapped == mapped )
+		return true;
+
+	Clear();
+
+	// Allocate memory for the two buffers, or map them from files
+	size_t size = sizeof( Cell ) * numCells;
+
+	if( mapped ) {
+		BufferA = (Cell*)MapBuffer( SwapDirectory.c_str(), size );
+		BufferB = (Cell*)MapBuffer( SwapDirectory.c_str(), size );
+	}
+	else {
+		BufferA = (Cell*)AllocateBuffer( size, HugePages );
+		BufferB = (Cell*)AllocateBuffer( size, HugePages );
+	}
+
+	BufferCapacity  = numCells;
+	BufferHugePages = HugePages;
+	BufferMapped    = mapped;
+
+	if( BufferA == NULL || BufferB == NULL ) {
+		Clear();
+		return false;
+	}
+
+	return true;
+
+}
+
+// The buffer that was written to last holds the result
+template< class Layout >
+const typename Layout::Cell* BasicJumpFlooder<Layout>::Result( void ) const {
+
+	if( HasResult == false )
+		return NULL;
+
+	return ReadingBufferA == true ? BufferA : BufferB;
+
+}
+
+template< class Layout >
+Point BasicJumpFlooder<Layout>::NearestSeed( int x, int y ) const {
+
+	Point p = { -1, -1 };
+
+	const Cell* Buffer = Result();
+	if( Buffer == NULL || x < 0 || x >= BufferWidth || y < 0 || y >= BufferHeight )
+		return p;
+
+	const Cell& c = Buffer[ (size_t)y * BufferWidth + x ];
+	if( Cells.IsEmpty( c ) == false ) {
+		p.x = Cells.X( c );
+		p.y = Cells.Y( c );
+	}
+
+	return p;
+
+}
+
+// Jump Flooding Algorithm
+template< class Layout >
+const typename Layout::Cell* BasicJumpFlooder<Layout>::Execute( const Point* seeds, int numSeeds, int width, int height ) {
+
+	// Forget the last result, but keep the buffers around for reuse
+	HasResult = false;
+	HasStats  = false;
+
+	if( numSeeds < 1 || width < 1 || height < 1 )
+		return NULL;
+
+	// Let the layout know about the seeds, and make sure it can hold them
+	if( Cells.SetSeeds( seeds, numSeeds ) == false )
+		return NULL;
+
+	// No seeds inside the grid will just give us an empty map
+	int numInside = 0;
+	for( int i = 0; i < numSeeds; ++i ) {
+		const Point& p = seeds[i];
+		if( p.x >= 0 && p.x < width && p.y >= 0 && p.y < height )
+			++numInside;
+	}
+
+	if( numInside < 1 )
+		return NULL;
+
+	BufferWidth  = width;
+	BufferHeight = height;
+
+	if( ReserveBuffers( (size_t)BufferWidth * BufferHeight ) == false )
+		return NULL;
+
+	// Initialize BufferA with empty cells, indicating an invalid closest seed. This is done by the
+	// same threads that will later work on each band, so their pages end up close to them.
+	RunParallel( &BasicJumpFlooder::InitializeBand );
+
+	// Put the seeds into the first buffer, skipping any that fall outside of it. In out-of-core
+	// mode, each seed can bring in a page of the file, so they are dropped every so often.
+	size_t pagesPerCap = MemoryCap / (size_t)sysconf( _SC_PAGESIZE );
+	if( pagesPerCap < 1 )
+		pagesPerCap = 1;
+	size_t numPlaced = 0;
+
+	for( int i = 0; i < numSeeds; ++i ) {
+		const Point& p = seeds[i];
+		if( p.x < 0 || p.x >= BufferWidth || p.y < 0 || p.y >= BufferHeight )
+			continue;
+		BufferA[ (size_t)p.y * BufferWidth + p.x ] = Cells.Make( i, p );
+
+		if( BufferMapped && ++numPlaced % pagesPerCap == 0 )
+			AdviseRows( BufferA, BufferWidth, BufferHeight, 0, BufferHeight, MADV_DONTNEED );
+	}
+
+	if( BufferMapped )
+		AdviseRows( BufferA, BufferWidth, BufferHeight, 0, BufferHeight, MADV_DONTNEED );
+
+	// Start the cell statistics from zero. The partial ones of the other threads were left that
+	// way by the last merge, unless there are more or fewer of them now.
+	if( CellStatsEnabled ) {
+
+		Cells.IndexSeeds( seeds, numSeeds );
+
+		SeedStats.assign( numSeeds, CellStats() );
+
+		size_t numPartial = (size_t)( NumThreads() - 1 ) * numSeeds;
+		if( PartialStats.size() != numPartial )
+			PartialStats.assign( numPartial, CellStats() );
+
+	}
+
+	// Carry out the rounds of Jump Flooding
+	NumSteps = GetStepSchedule( Schedule, FirstStep(), Steps );
+	RunParallel( &BasicJumpFlooder::FloodBand );
+
+	// Every round swaps the buffers, so the result is in BufferA after an even number of rounds
+	ReadingBufferA = NumSteps % 2 == 0;
+
+	// A single pixel has no passes for the distances and statistics to be fused into
+	if( NumSteps == 0 ) {
+		for( int y = 0; y < BufferHeight; ++y ) {
+			if( DistanceOutput != NULL )
+				WriteDistances( BufferA, y, 0, BufferWidth );
+			if( CellStatsEnabled )
+				AccumulateStats( BufferA, y, 0, BufferWidth, 0 );
+		}
+	}
+
+	if( CellStatsEnabled ) {
+
+		if( Pool != NULL )
+			RunParallel( &BasicJumpFlooder::MergeStatsBand );
+
+		// A cell of several seeds sharing a position goes to the first of them
+		for( int i = 0; i < numSeeds; ++i ) {
+			int first = Cells.FirstSeed( i );
+			if( first != i && SeedStats[i].area > 0 ) {
+				MergeCellStats( SeedStats[ first ], SeedStats[i] );
+				SeedStats[i] = CellStats();
+			}
+		}
+
+		HasStats = true;
+
+	}
+
+	HasResult = true;
+
+	return Result();
+
+}
+
+template< class Layout >
+bool BasicJumpFlooder<Layout>::DistanceTransform( const unsigned char* mask, int width, int height, DistanceMode mode,
+                                                  DistanceFormat format, float maxDistance, void* output ) {
+
+	if( mask == NULL || output == NULL || width < 1 || height < 1 )
+		return false;
+
+	// The foreground pixels next to the background are the seeds. Pixels outside the mask don't
+	// count, so shapes touching its sides carry on beyond them.
+	MaskSeeds.clear();
+
+	for( int y = 0; y < height; ++y ) {
+		for( int x = 0; x < width; ++x ) {
+
+			const unsigned char* m = mask + (size_t)y * width + x;
+			if( *m < MASK_THRESHOLD )
+				continue;
+
+			if( ( x > 0          && m[ -1 ]     < MASK_THRESHOLD ) ||
+			    ( x < width - 1  && m[ 1 ]      < MASK_THRESHOLD ) ||
+			    ( y > 0          && m[ -width ] < MASK_THRESHOLD ) ||
+			    ( y < height - 1 && m[ width ]  < MASK_THRESHOLD ) ) {
+				Point p = { x, y };
+				MaskSeeds.push_back( p );
+			}
+
+		}
+	}
+
+	if( MaskSeeds.empty() )
+		return false;
+
+	DistanceMask   = mask;
+	DistanceOutput = output;
+	DistMode       = mode;
+	DistFormat     = format;
+	MaxDistance    = maxDistance > 0 ? maxDistance : 1;
+
+	const Cell* map = Execute( &MaskSeeds[0], MaskSeeds.size(), width, height );
+
+	DistanceMask   = NULL;
+	DistanceOutput = NULL;
+
+	return map != NULL;
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::WriteDistances( const Cell* map, int y, int xBegin, int xEnd ) {
+
+	for( int x = xBegin; x < xEnd; ++x ) {
+
+		size_t idx = (size_t)y * BufferWidth + x;
+
+		// Jump Flooding may leave pixels that no seed reached (on grids whose sides aren't powers
+		// of two). They are infinitely far, which saturates the quantized formats.
+		const Cell& c = map[ idx ];
+		float dist = INFINITY;
+		if( Cells.IsEmpty( c ) == false ) {
+			int dx = Cells.X( c ) - x;
+			int dy = Cells.Y( c ) - y;
+			dist = sqrtf( SquaredDistance( dx, dy ) );
+		}
+
+		bool inside = DistanceMask[ idx ] >= MASK_THRESHOLD;
+
+		// Where the value falls in the range of the quantized formats
+		float value, unit;
+
+		if( DistMode == DISTANCE_SIGNED ) {
+			value = inside ? -( dist + 0.5f ) : dist - 0.5f;
+			unit  = 0.5f + value / ( 2 * MaxDistance );
+		}
+		else {
+			value = inside ? 0 : dist;
+			unit  = value / MaxDistance;
+		}
+
+		unit = unit < 0 ? 0 : unit > 1 ? 1 : unit;
+
+		switch( DistFormat ) {
+			case DISTANCE_UINT8:
+				( (unsigned char*)DistanceOutput )[ idx ] = (unsigned char)( unit * 255 + 0.5f );
+				break;
+
+			case DISTANCE_UINT16:
+				( (unsigned short*)DistanceOutput )[ idx ] = (unsigned short)( unit * 65535 + 0.5f );
+				break;
+
+			default:
+				( (float*)DistanceOutput )[ idx ] = value;
+				break;
+		}
+
+	}
+
+}
+
+// Neighboring pixels mostly share their seed, so each run of them is added at once. With many
+// small cells, their statistics are scattered over memory in the order of the seeds, so every run
+// would wait for its seed's index and then its statistics to be read. Instead, runs are taken in
+// batches: the lookups of a whole batch are prefetched, then the statistics, then they're added.
+template< class Layout >
+void BasicJumpFlooder<Layout>::AccumulateStats( const Cell* map, int y, int xBegin, int xEnd, int threadIdx ) {
+
+	CellStats* stats = threadIdx == 0 ? &SeedStats[0] : &PartialStats[ (size_t)( threadIdx - 1 ) * SeedStats.size() ];
+	const Cell* row = map + (size_t)y * BufferWidth;
+
+	int runBegins[ STATS_BATCH_RUNS ];
+	int runEnds[ STATS_BATCH_RUNS ];
+	int runSeeds[ STATS_BATCH_RUNS ];
+
+	int x = xBegin;
+
+	while( x < xEnd ) {
+
+		int numRuns = 0;
+		while( x < xEnd && numRuns < STATS_BATCH_RUNS ) {
+
+			int begin = x;
+			const Cell& c = row[x];
+			for( ++x; x < xEnd && Cells.Equal( row[x], c ); ++x );
+
+			// Jump Flooding may leave pixels that no seed reached, which belong to no cell
+			if( Cells.IsEmpty( c ) )
+				continue;
+
+			runBegins[ numRuns ] = begin;
+			runEnds[ numRuns ]   = x;
+			Cells.PrefetchSeedIndex( c );
+			++numRuns;
+
+		}
+
+		for( int r = 0; r < numRuns; ++r ) {
+			runSeeds[r] = Cells.SeedIndex( row[ runBegins[r] ] );
+			__builtin_prefetch( &stats[ runSeeds[r] ], 1, 3 );
+		}
+
+		for( int r = 0; r < numRuns; ++r ) {
+
+			CellStats& s = stats[ runSeeds[r] ];
+			int first = runBegins[r];
+			int last  = runEnds[r] - 1;
+			long long runLength = last - first + 1;
+
+			if( s.area == 0 ) {
+				s.minX = first;
+				s.maxX = last;
+				s.minY = s.maxY = y;
+			}
+			else {
+				s.minX = first < s.minX ? first : s.minX;
+				s.maxX = last > s.maxX ? last : s.maxX;
+				s.minY = y < s.minY ? y : s.minY;
+				s.maxY = y > s.maxY ? y : s.maxY;
+			}
+
+			// The x coordinates of the run add up to its length times their average
+			s.area += runLength;
+			s.sumX += runLength * ( first + last ) / 2;
+			s.sumY += runLength * y;
+
+		}
+
+	}
+
+}
+
+template< class Layout >
+void BasicJumpFlooder<Layout>::MergeStatsBand( int threadIdx, int numThreads ) {
+
+	int numSeeds = (int)SeedStats.size();
+
+	int begin, end;
+	GetBand( numSeeds, threadIdx, numThreads, begin, end );
+
+	for( int t = 0; t < numThreads - 1; ++t ) {
+
+		CellStats* partial = &PartialStats[ (size_t)t * numSeeds ];
+
+		for( int i = begin; i < end; ++i ) {
+
+			CellStats& p = partial[i];
+			if( p.area == 0 )
+				continue;
+
+			MergeCellStats( SeedStats[i], p );
+
+			// Ready for the next execution
+			p.area = p.sumX = p.sumY = 0;
+
+		}
+
+	}
+
+}
+
+// Index of another seed sitting at position p, or -1 if there is none
+static int FindSeedAt( const Point* seeds, int numSeeds, Point p, int skip ) {
+
+	for( int k = 0; k < numSeeds; ++k )
+		if( k != skip && seeds[k].x == p.x && seeds[k].y == p.y )
+			return k;
+
+	return -1;
+
+}
+
+template< class Layout >
+const typename Layout::Cell* BasicJumpFlooder<Layout>::MoveSeed( const Point* seeds, int numSeeds, int i, Point from ) {
+
+	if( HasResult == false || i < 0 || i >= numSeeds )
+		return NULL;
+
+	// The cell statistics would no longer match the map
+	HasStats = false;
+
+	if( Cells.SetSeeds( seeds, numSeeds ) == false )
+		return NULL;
+
+	Cell* map = ReadingBufferA == true ? BufferA : BufferB;
+
+	// Hand the seed's old pixels over to its neighbors. If another seed sits at the same spot,
+	// they simply become its pixels.
+	CollectRegion( map, Cells.Make( i, from ) );
+
+	bool filled = true;
+	int k = FindSeedAt( seeds, numSeeds, from, i );
+
+	if( k != -1 ) {
+		for( size_t j = 0; j < Region.size(); ++j )
+			map[ Region[j] ] = Cells.Make( k, from );
+	}
+	else
+		filled = AssignRegion( map );
+
+	// Then let it take over the pixels around its new position
+	bool grown = GrowRegion( map, seeds[i], Cells.Make( i, seeds[i] ) );
+
+	// Moving the only seed out of the grid leaves nothing
+	if( filled == false && grown == false ) {
+		HasResult = false;
+		return NULL;
+	}
+
+	return Result();
+
+}
+
+template< class Layout >
+const typename Layout::Cell* BasicJumpFlooder<Layout>::AddSeed( const Point* seeds, int numSeeds ) {
+
+	if( HasResult == false || numSeeds < 1 )
+		return NULL;
+
+	// The cell statistics would no longer match the map
+	HasStats = false;
+
+	if( Cells.SetSeeds( seeds, numSeeds ) == false )
+		return NULL;
+
+	Cell* map = ReadingBufferA == true ? BufferA : BufferB;
+
+	int i = numSeeds - 1;
+	GrowRegion( map, seeds[i], Cells.Make( i, seeds[i] ) );
+
+	return Result();
+
+}
+
+template< class Layout >
+const typename Layout::Cell* BasicJumpFlooder<Layout>::RemoveSeed( const Point* seeds, int numSeeds, int i, Point removed ) {
+
+	if( HasResult == false || i < 0 || i > numSeeds )
+		return NULL;
+
+	// The cell statistics would no longer match the map
+	HasStats = false;
+
+	if( Cells.SetSeeds( seeds, numSeeds ) == false )
+		return NULL;
+
+	Cell* map = ReadingBufferA == true ? BufferA : BufferB;
+
+	Cell owner = Cells.Make( i, removed );
+
+	// If another seed sits at the same spot, the pixels become its own
+	int k = FindSeedAt( seeds, numSeeds, removed, -1 );
+	Cell heir = k != -1 ? Cells.Make( k, removed ) : Cells.Empty();
+
+	// The indices of the seeds after the removed one change, and Jump Flooding may have left
+	// pixels of the removed seed that aren't connected to the rest of them, so go over every pixel
+	Region.clear();
+
+	size_t numCells = (size_t)BufferWidth * BufferHeight;
+	for( size_t idx = 0; idx < numCells; ++idx ) {
+
+		if( Cells.Equal( map[ idx ], owner ) ) {
+			map[ idx ] = heir;
+			if( k == -1 )
+				Region.push_back( idx );
+		}
+		else
+			map[ idx ] = Cells.Renumber( map[ idx ], i );
+
+	}
+
+	// Removing the last seed in the grid leaves nothing
+	if( AssignRegion( map ) == false ) {
+		HasResult = false;
+		return NULL;
+	}
+
+	return Result();
+
+}
+
+// Jump Flooding can leave pieces of a cell cut off from the rest, which a flood fill from the
+// seed wouldn't reach, so the whole map is scanned
+template< class Layout >
+void BasicJumpFlooder<Layout>::CollectRegion( Cell* map, const Cell& owner ) {
+
+	Region.clear();
+
+	size_t numCells = (size_t)BufferWidth * BufferHeight;
+	for( size_t idx = 0; idx < numCells; ++idx ) {
+		if( Cells.Equal( map[ idx ], owner ) ) {
+			map[ idx ] = Cells.Empty();
+			Region.push_back( idx );
+		}
+	}
+
+}
+
+// In an exact Voronoi diagram, cells are convex, so the segment between an emptied pixel and its
+// closest seed can only enter the region through a pixel of that same seed, and the seeds of the
+// pixels around the region would be the only ones to consider. Jump Flooding's map is only close
+// to exact, so the closest seed can occasionally be missed, as in Jump Flooding itself.
+template< class Layout >
+bool BasicJumpFlooder<Layout>::AssignRegion( Cell* map ) {
+
+	Candidates.clear();
+
+	for( size_t i = 0; i < Region.size(); ++i ) {
+
+		int x = (int)( Region[i] % BufferWidth );
+		int y = (int)( Region[i] / BufferWidth );
+
+		for( int ky = -1; ky <= 1; ++ky ) {
+			for( int kx = -1; kx <= 1; ++kx ) {
+
+				int nx = x + kx;
+				int ny = y + ky;
+
+				if( nx < 0 || nx >= BufferWidth || ny < 0 || ny >= BufferHeight )
+					continue;
+
+				const Cell& c = map[ (size_t)ny * BufferWidth + nx ];
+				if( Cells.IsEmpty( c ) )
+					continue;
+
+				bool known = false;
+				for( size_t j = Candidates.size(); j > 0 && known == false; --j )
+					known = Cells.Equal( Candidates[ j - 1 ], c );
+
+				if( known == false )
+					Candidates.push_back( c );
+
+			}
+		}
+
+	}
+
+	if( Candidates.empty() )
+		return Region.empty();
+
+	for( size_t i = 0; i < Region.size(); ++i ) {
+
+		int x = (int)( Region[i] % BufferWidth );
+		int y = (int)( Region[i] / BufferWidth );
+
+		size_t closest = 0;
+		long long closestDist = -1;
+
+		for( size_t j = 0; j < Candidates.size(); ++j ) {
+
+			long long dx = Cells.X( Candidates[j] ) - x;
+			long long dy = Cells.Y( Candidates[j] ) - y;
+			long long dist = dx*dx + dy*dy;
+
+			if( closestDist == -1 || dist < closestDist ) {
+				closest = j;
+				closestDist = dist;
+			}
+
+		}
+
+		map[ Region[i] ] = Candidates[ closest ];
+
+	}
+
+	return true;
+
+}
+
+// Flood fill from the seed's position over the pixels that are empty or closer to it than to
+// their current seed. Since its Voronoi cell is convex, those pixels are connected to the seed.
+template< class Layout >
+bool BasicJumpFlooder<Layout>::GrowRegion( Cell* map, Point seed, const Cell& owner ) {
+
+	Region.clear();
+
+	if( seed.x < 0 || seed.x >= BufferWidth || seed.y < 0 || seed.y >= BufferHeight )
+		return false;
+
+	size_t idx = (size_t)seed.y * BufferWidth + seed.x;
+	map[ idx ] = owner;
+	Region.push_back( idx );
+
+	for( size_t i = 0; i < Region.size(); ++i ) {
+
+		int x = (int)( Region[i] % BufferWidth );
+		int y = (int)( Region[i] / BufferWidth );
+
+		for( int ky = -1; ky <= 1; ++ky ) {
+			for( int kx = -1; kx <= 1; ++kx ) {
+
+				int nx = x + kx;
+				int ny = y + ky;
+
+				if( nx < 0 || nx >= BufferWidth || ny < 0 || ny >= BufferHeight )
+					continue;
+
+				size_t nidx = (size_t)ny * BufferWidth + nx;
+				const Cell& c = map[ nidx ];
+
+				// Pixels we already own have been visited
+				if( Cells.Equal( c, owner ) )
+					continue;
+
+				if( Cells.IsEmpty( c ) == false ) {
+					long long cx = Cells.X( c ) - nx;
+					long long cy = Cells.Y( c ) - ny;
+					long long sx = seed.x - nx;
+					long long sy = seed.y - ny;
+					if( sx*sx + sy*sy >= cx*cx + cy*cy )
+						continue;
+				}
+
+				map[ nidx ] = owner;
+				Region.push_back( nidx );
+
+			}
+		}
+
+	}
+
+	return true;
+
+}
+
+// Initialize a band of BufferA with empty cells.
+// We don't need to initialize BufferB because it will be written to in the first round.
+template< class Layout >
+void BasicJumpFlooder<Layout>::InitializeBand( int threadIdx, int numThreads ) {
+
+	int yBegin, yEnd;
+	GetBand( BufferHeight, threadIdx, numThreads, yBegin, yEnd );
+
+	// Every layout marks empty cells with all bits set ((-1,-1) or the largest index), so a
+	// memset, which the C library vectorizes, does the job
+	Cell empty = Cells.Empty();
+	const unsigned char* bytes = (const unsigned char*)&empty;
+
+	bool allOnes = true;
+	for( size_t i = 0; i < sizeof( Cell ); ++i )
+		allOnes = allOnes && bytes[i] == 0xFF;
+
+	// In out-of-core mode, the threads share the memory cap, filling and dropping a chunk of
+	// their band at a time
+	int chunkRows = yEnd - yBegin;
+	if( BufferMapped ) {
+		chunkRows = 4 * StreamRows() / numThreads;
+		chunkRows = chunkRows > 0 ? chunkRows : 1;
+	}
+
+	for( int y = yBegin; y < yEnd; y += chunkRows ) {
+
+		int yChunkEnd = y + chunkRows < yEnd ? y + chunkRows : yEnd;
+
+		Cell* chunk = BufferA + (size_t)y * BufferWidth;
+		size_t numCells = (size_t)( yChunkEnd - y ) * BufferWidth;
+
+		if( allOnes )
+			memset( chunk, 0xFF, sizeof( Cell ) * numCells );
+		else
+			for( size_t i = 0; i < numCells; ++i )
+				chunk[i] = empty;
+
+		if( BufferMapped )
+			AdviseRows( BufferA, BufferWidth, BufferHeight, y, yChunkEnd, MADV_DONTNEED );
+
+	}
+
+}
+
+// All the rounds of Jump Flooding for one band of rows. Within a round, a band only reads from
+// RBuffer and only writes its own rows of WBuffer, so the threads only need to wait for each
+// other between rounds.
+template< class Layout >
+void BasicJumpFlooder<Layout>::FloodBand( int threadIdx, int numThreads ) {
+
+	int yBegin, yEnd;
+	GetBand( BufferHeight, threadIdx, numThreads, yBegin, yEnd );
+
+	// We use this boolean to know which buffer we are reading from
+	bool readingBufferA = true;
+
+	// Thread 0 times the passes, which all threads finish together at the barrier
+	bool timing = PassTiming && threadIdx == 0;
+	double passStart = timing ? GetClockMsec() : 0;
+
+	// The steps come from the schedule, which for plain Jump Flooding halves them from FirstStep()
+	for( int round = 0; round < NumSteps; ++round ) {
+
+		int step = Steps[ round ];
+
+		// Set which buffers we'll be using
+		const Cell* RBuffer = readingBufferA == true ? BufferA : BufferB;
+		Cell* WBuffer = readingBufferA == true ? BufferB : BufferA;
+
+		// Tiles only pay off once the rows between a row and its neighbors don't fit in the cache
+		if( BufferMapped )
+			StreamBands( RBuffer, WBuffer, step, threadIdx, numThreads, round == NumSteps - 1 );
+		else if( Mode == TRAVERSAL_TILED && (size_t)step * BufferWidth * sizeof( Cell ) > CacheSize / 2 )
+			FloodTiles( RBuffer, WBuffer, step, threadIdx, numThreads, round == NumSteps - 1 );
+		else
+			FloodRows( RBuffer, WBuffer, step, yBegin, yEnd, threadIdx, round == NumSteps - 1 );
+
+		// Wait for the other bands before anyone reads this round's results
+		if( Pool != NULL )
+			Pool->Barrier();
+
+		if( timing ) {
+			double passEnd = GetClockMsec();
+			PassTimes[ round ] = passEnd - passStart;
+			passStart = passEnd;
+		}
+
+		// Swap the buffers for the next round
+		readingBufferA = !readingBufferA;
+
+	}
+
+}
+
+// Find the closest seed of each point in rows [yBegin,yEnd)
+template< class Layout >
+void BasicJumpFlooder<Layout>::FloodRows( const Cell* RBuffer, Cell* WBuffer, int step, int yBegin, int yEnd, int threadIdx, bool finalPass ) {
+
+	bool distances = finalPass && DistanceOutput != NULL;
+	bool stats     = finalPass && CellStatsEnabled;
+
+	for( int y = yBegin; y < yEnd; ++y ) {
+
+		FloodSpan( RBuffer, WBuffer, step, y, 0, BufferWidth );
+
+		// The row we just wrote is still in the cache
+		if( distances )
+			WriteDistances( WBuffer, y, 0, BufferWidth );
+		if( stats )
+			AccumulateStats( WBuffer, y, 0, BufferWidth, threadIdx );
+
+	}
+
+}
+
+// Find the closest seed of each point, one band of rows at a time, for buffers mapped from files.
+//
+// A band's rows read the rows step above and below them as well, so a pass over a band touches
+// three bands of RBuffer and one of WBuffer, which the memory cap must hold. While the threads
+// split the rows of one band, thread 0 asks for the next one to be read ahead, and once they are
+// all done with it, it drops the band's pages from memory. Written pages are saved to the files by
+// the kernel in the background.
+template< class Layout >
+void BasicJumpFlooder<Layout>::StreamBands( const Cell* RBuffer, Cell* WBuffer, int step, int threadIdx, int numThreads, bool finalPass ) {
+
+	int bandRows = StreamRows();
+
+	for( int y0 = 0; y0 < BufferHeight; y0 += bandRows ) {
+
+		int y1 = y0 + bandRows < BufferHeight ? y0 + bandRows : BufferHeight;
+
+		if( threadIdx == 0 && y1 < BufferHeight ) {
+			int y2 = y1 + bandRows;
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y1 - step, y2 - step, MADV_WILLNEED );
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y1, y2, MADV_WILLNEED );
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y1 + step, y2 + step, MADV_WILLNEED );
+		}
+
+		int yBegin, yEnd;
+		GetBand( y1 - y0, threadIdx, numThreads, yBegin, yEnd );
+
+		FloodRows( RBuffer, WBuffer, step, y0 + yBegin, y0 + yEnd, threadIdx, finalPass );
+
+		// Nobody may drop rows someone else is still reading
+		if( Pool != NULL )
+			Pool->Barrier();
+
+		if( threadIdx == 0 ) {
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y0 - step, y1 - step, MADV_DONTNEED );
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y0, y1, MADV_DONTNEED );
+			AdviseRows( RBuffer, BufferWidth, BufferHeight, y0 + step, y1 + step, MADV_DONTNEED );
+			AdviseRows( WBuffer, BufferWidth, BufferHeight, y0, y1, MADV_DONTNEED );
+		}
+
+	}
+
+}
+
+template< class Layout >
+int BasicJumpFlooder<Layout>::StreamRows( void ) const {
+
+	size_t rows = MemoryCap / ( 4 * sizeof( Cell ) * (size_t)BufferWidth );
+
+	if( rows < 1 )
+		return 1;
+
+	return rows < (size_t)BufferHeight ? (int)rows : BufferHeight;
+
+}
+
+// Find the closest seed of each point in the share of tiles belonging to a thread.
+//
+// With large steps, the row-major sweep reads each row three times: as the row step below one
+// row, as a row itself, and as the row step above another, each time step rows apart. Once step
+// rows no longer fit in the cache, every one of those reads goes to memory. Instead, we take
+// blocks of TILE_BLOCK_ROWS consecutive rows and move them down step rows at a time, so the block
+// read as the neighbors below is the next block to be processed, and the one after that is
+// prefetched while we work. Blocks are cut into column tiles so that the three blocks being
+// read stay within TILE_WORKING_SET bytes. Each tile is written by exactly one thread, so there
+// is still only one barrier per step.
+template< class Layout >
+void BasicJumpFlooder<Layout>::FloodTiles( const Cell* RBuffer, Cell* WBuffer, int step, int threadIdx, int numThreads, bool finalPass ) {
+
+	bool distances = finalPass && DistanceOutput != NULL;
+	bool stats     = finalPass && CellStatsEnabled;
+
+	int tileWidth = (int)( TILE_WORKING_SET / ( 3 * TILE_BLOCK_ROWS * sizeof( Cell ) ) );
+	if( tileWidth > BufferWidth )
+		tileWidth = BufferWidth;
+
+	// Rows y and y+step belong to the same chain, so there are step chains (or fewer, if the
+	// buffer isn't that tall), grouped into blocks of consecutive chains
+	int numTiles  = ( BufferWidth + tileWidth - 1 ) / tileWidth;
+	int numChains = step < BufferHeight ? step : BufferHeight;
+	int numBlocks = ( numChains + TILE_BLOCK_ROWS - 1 ) / TILE_BLOCK_ROWS;
+
+	// Hand out contiguous runs of (tile,block) pairs, so that a thread's blocks are next to each other
+	long long numItems = (long long)numTiles * numBlocks;
+	long long begin = numItems * threadIdx / numThreads;
+	long long end   = numItems * ( threadIdx + 1 ) / numThreads;
+
+	for( long long item = begin; item < end; ++item ) {
+
+		int tile  = (int)( item / numBlocks );
+		int block = (int)( item % numBlocks );
+
+		int xBegin = tile * tileWidth;
+		int xEnd   = xBegin + tileWidth < BufferWidth ? xBegin + tileWidth : BufferWidth;
+
+		int chainBegin = block * TILE_BLOCK_ROWS;
+		int chainEnd   = chainBegin + TILE_BLOCK_ROWS < numChains ? chainBegin + TILE_BLOCK_ROWS : numChains;
+
+		for( int y0 = 0; y0 < BufferHeight; y0 += step ) {
+			for( int y = y0 + chainBegin; y < y0 + chainEnd && y < BufferHeight; ++y ) {
+
+				// The row step below the next one is the only row the next iteration doesn't have yet
+				int ny = y + 2 * step;
+				if( ny < BufferHeight ) {
+					const Cell* row = RBuffer + (size_t)ny * BufferWidth;
+					PrefetchCells( row, xBegin - step > 0 ? xBegin - step : 0, xEnd - step > 0 ? xEnd - step : 0 );
+					PrefetchCells( row, xBegin, xEnd );
+					PrefetchCells( row, xBegin + step < BufferWidth ? xBegin + step : BufferWidth,
+					                    xEnd + step < BufferWidth ? xEnd + step : BufferWidth );
+				}
+
+				FloodSpan( RBuffer, WBuffer, step, y, xBegin, xEnd );
+
+				if( distances )
+					WriteDistances( WBuffer, y, xBegin, xEnd );
+				if( stats )
+					AccumulateStats( WBuffer, y, xBegin, xEnd, threadIdx );
+
+			}
+		}
+
+	}
+
+}
+
+// Find the closest seed of each point in [xBegin,xEnd) of row y
+template< class Layout >
+void BasicJumpFlooder<Layout>::FloodSpan( const Cell* RBuffer, Cell* WBuffer, int step, int y, int xBegin, int xEnd ) {
+
+	// If the rows step above and below us exist, only the first and last step pixels of this
+	// row can have neighbors outside the buffer. The rest go through the vectorized kernel.
+	if( y - step >= 0 && y + step < BufferHeight ) {
+
+		int interiorBegin = xBegin > step ? xBegin : step;
+		int interiorEnd   = xEnd < BufferWidth - step ? xEnd : BufferWidth - step;
+
+		if( interiorBegin < interiorEnd ) {
+			FloodBorder( RBuffer, WBuffer, step, y, xBegin, interiorBegin );
+			Cells.Interior( RBuffer, WBuffer, BufferWidth, y, step, interiorBegin, interiorEnd );
+			FloodBorder( RBuffer, WBuffer, step, y, interiorEnd, xEnd );
+			return;
+		}
+
+	}
+
+	FloodBorder( RBuffer, WBuffer, step, y, xBegin, xEnd );
+
+}
+
+// Find the closest seed of each point in [xBegin,xEnd) of row y, checking every neighbor's bounds
+template< class Layout >
+void BasicJumpFlooder<Layout>::FloodBorder( const Cell* RBuffer, Cell* WBuffer, int step, int y, int xBegin, int xEnd ) {
+
+	for( int x = xBegin; x < xEnd; ++x ) {
+
+		// The point's absolute index in the buffer
+		size_t idx = (size_t)y * BufferWidth + x;
+
+		// The point's current closest seed (if any)
+		const Cell& p = RBuffer[ idx ];
+
+		// Go ahead and write our current closest seed, if any. If we don't do this
+		// we might lose this information if we don't update our seed this round.
+		WBuffer[ idx ] = p;
+
+		// This variable will be used to judge which seed is closest
+		float dist;
+
+		if( Cells.IsEmpty( p ) )
+			dist = -1; // No closest seed has been found yet
+		else {
+			int px = Cells.X( p );
+			int py = Cells.Y( p );
+
+			// This is a seed, so skip this point
+			if( px == x && py == y )
+				continue;
+
+			dist = SquaredDistance( px - x, py - y ); // Current closest seed's distance
+		}
+
+		// To find each point's closest seed, we look at its 8 neighbors thusly:
+		//   (x-step,y-step) (x,y-step) (x+step,y-step)
+		//   (x-step,y     ) (x,y     ) (x+step,y     )
+		//   (x-step,y+step) (x,y+step) (x+step,y+step)
+
+		for( int ky = -1; ky <= 1; ++ky ) {
+			for( int kx = -1; kx <= 1; ++kx ) {
+
+				// Calculate neighbor's row and column
+				int ny = y + ky * step;
+				int nx = x + kx * step;
+
+				// If the neighbor is outside the bounds of the buffer, skip it
+				if( nx < 0 || nx >= BufferWidth || ny < 0 || ny >= BufferHeight )
+					continue;
+
+				// Calculate neighbor's absolute index
+				size_t nidx = (size_t)ny * BufferWidth + nx;
+
+				// Retrieve the neighbor
+				const Cell& pk = RBuffer[ nidx ];
+
+				// If the neighbor doesn't have a closest seed yet, skip it
+				if( Cells.IsEmpty( pk ) )
+					continue;
+
+				// Calculate the distance from us to the neighbor's closest seed
+				int sx = Cells.X( pk );
+				int sy = Cells.Y( pk );
+				float newDist = SquaredDistance( sx - x, sy - y );
+
+				// If dist is -1, it means we have no closest seed, so we might as well take this one
+				// Otherwise, only adopt this new seed if it's closer than our current closest seed
+				if( dist == -1 || newDist < dist ) {
+					WBuffer[ idx ] = pk;
+					dist = newDist;
+				}
+
+			}
+		}
+
+	}
+
+}
+
+// The layouts we support
+template class BasicJumpFlooder< PointLayout >;
+template class BasicJumpFlooder< IndexLayout<unsigned int> >;
+template class BasicJumpFlooder< IndexLayout<unsigned short> >;
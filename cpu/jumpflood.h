@@ -0,0 +1,341 @@
+/*=================================================================================================
+  About: The Jump Flooding core from "Jump Flooding in GPU With Applications to Voronoi Diagram and
+   Distance Transform" [Rong 2006], without any windowing or OpenGL dependencies. A JumpFlooder
+   owns its ping-pong buffers and turns a list of seeds into a nearest-seed map, so it can be used
+   by the interactive viewer as well as by headless tools.
+
+   What each pixel of the map holds is decided by the Layout template parameter (see layout.h).
+   JumpFlooder stores seed coordinates, while IndexJumpFlooder and SmallIndexJumpFlooder store
+   32-bit and 16-bit seed indices, which take half and a quarter of the memory.
+=================================================================================================*/
+
+#ifndef _JUMPFLOOD_H_
+#define _JUMPFLOOD_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "kernel.h"
+#include "layout.h"
+#include "point.h"
+#include "schedule.h"
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+class ThreadPool;
+
+// The order in which the pixels of each pass are visited
+enum Traversal {
+	TRAVERSAL_ROWS = 0, // Row by row, each thread working on its own band of rows
+	TRAVERSAL_TILED     // For large steps, in blocks of rows moved down step rows at a time
+};
+
+// What a distance transform measures
+enum DistanceMode {
+	DISTANCE_UNSIGNED = 0, // Distance to the closest foreground pixel, 0 on the foreground
+	DISTANCE_SIGNED        // Distance to the shape's edge, negative inside and positive outside
+};
+
+// How the values of a distance field are stored
+enum DistanceFormat {
+	DISTANCE_FLOAT = 0, // 32-bit floats, in pixels
+	DISTANCE_UINT8,     // Quantized to 8 bits, see DistanceTransform()
+	DISTANCE_UINT16     // Quantized to 16 bits
+};
+
+// Statistics of a seed's Voronoi cell, the pixels it is the closest seed of. Pixels are measured
+// at their centers, in the same coordinates as the seeds.
+struct CellStats {
+
+	long long area;             // Number of pixels, 0 if the cell is empty
+	long long sumX, sumY;       // Sums of the pixels' coordinates
+	int minX, minY, maxX, maxY; // Bounding box, inclusive, if the cell isn't empty
+
+	// Center of mass of the cell, which mustn't be empty. Lloyd relaxation moves each seed there.
+	double CentroidX( void ) const { return (double)sumX / area; }
+	double CentroidY( void ) const { return (double)sumY / area; }
+
+};
+
+template< class Layout >
+class BasicJumpFlooder {
+
+public:
+
+	// What each pixel of the map holds
+	typedef typename Layout::Cell Cell;
+
+	BasicJumpFlooder( void );
+	~BasicJumpFlooder( void );
+
+	// Runs the Jump Flooding algorithm for numSeeds seeds over a width x height grid and returns
+	// the nearest-seed map, where each pixel identifies its closest seed. Seeds outside the grid
+	// are ignored. Returns NULL if there are no usable seeds, or if the layout can't represent
+	// that many seeds, or if the buffer files of SetOutOfCore() can't be created. The map remains
+	// valid until the next call to Execute() or Clear().
+	//
+	// The buffers are kept between calls and only reallocated when a larger grid is requested,
+	// so repeated executions at the same resolution do no heap allocation.
+	const Cell* Execute( const Point* seeds, int numSeeds, int width, int height );
+
+	// Euclidean distance transform of a width x height mask, where pixels of 128 or more are the
+	// foreground, so both binary masks and alpha channels can be used. The foreground pixels with
+	// a background pixel above, below or beside them are flooded as seeds, and output receives
+	// width * height values in the given format. The distances are computed in the last pass, as
+	// each of its rows is written, so there is no separate sweep over the map.
+	//
+	// Signed distances are measured to the edges between foreground and background pixels, half
+	// a pixel away from the centers of the seeds. The quantized formats map distances from 0 to
+	// maxDistance (unsigned) or from -maxDistance to maxDistance (signed, with the edge halfway)
+	// to their full range, clamping anything beyond. Pixels that no seed reached, which Jump
+	// Flooding can leave on grids whose sides aren't powers of two, are infinitely far. Returns
+	// false if the mask has no boundary pixels or the layout can't hold that many of them.
+	// Afterwards, the nearest-seed map holds the closest boundary pixel of each pixel.
+	bool DistanceTransform( const unsigned char* mask, int width, int height, DistanceMode mode,
+	                        DistanceFormat format, float maxDistance, void* output );
+
+	// Incremental updates of the last map after a single seed changed, which only revisit the
+	// pixels around that seed instead of flooding the whole grid again. seeds and numSeeds are
+	// all the seeds after the change, as they would be given to Execute(). The pixels of the
+	// changed seed are handed to the closest of the seeds bordering them, and a new or moved seed
+	// takes over the pixels around it that are closer to it than to their current seed. The
+	// result can differ from a full Execute() where Jump Flooding itself misses the closest seed
+	// or two seeds are equally close. Each returns the updated map, or NULL if there was no map
+	// to update (nothing is done), or if the map became empty.
+
+	// Seed i moved from position from to seeds[i]. The whole map is scanned for its old pixels,
+	// since Jump Flooding can leave some of them apart from the rest.
+	const Cell* MoveSeed( const Point* seeds, int numSeeds, int i, Point from );
+
+	// A seed was appended at seeds[numSeeds-1]
+	const Cell* AddSeed( const Point* seeds, int numSeeds );
+
+	// The seed at position removed was erased from index i of the array, so the seeds after it
+	// moved down by one. The whole map is scanned for its pixels, so this is slower than the others.
+	const Cell* RemoveSeed( const Point* seeds, int numSeeds, int i, Point removed );
+
+	// If the buffers exist, delete them, releasing their memory
+	void Clear( void );
+
+	// The last nearest-seed map, or NULL if there is none
+	const Cell* Result( void ) const;
+
+	// Coordinates of the closest seed of (x,y) in the last map, or (-1,-1) if it has none
+	Point NearestSeed( int x, int y ) const;
+
+	// Dimensions of the last nearest-seed map
+	int Width( void ) const { return BufferWidth; }
+	int Height( void ) const { return BufferHeight; }
+
+	// Sets how many threads execute the algorithm. Each pass is split into bands of rows, one per
+	// thread, and the threads wait for each other only once per step. Values less than 1 use one
+	// thread per hardware thread. The default is a single thread.
+	void SetNumThreads( int numThreads );
+	int NumThreads( void ) const;
+
+	// Sets the instruction set used for the interior of each pass. By default, and whenever the
+	// requested one isn't supported by this CPU, the fastest supported one is used.
+	void SetKernelISA( KernelISA isa );
+	KernelISA GetKernelISA( void ) const { return ISA; }
+
+	// Sets the order in which the pixels of each pass are visited. The tiled traversal keeps the
+	// neighbor rows of large steps in the cache and prefetches the next ones. The result is the
+	// same either way. The default is TRAVERSAL_ROWS.
+	void SetTraversal( Traversal mode );
+	Traversal GetTraversal( void ) const { return Mode; }
+
+	// If enabled, the buffers are aligned to huge pages and the kernel is asked to back them with
+	// transparent huge pages, which saves TLB misses on large grids. Changing it reallocates the
+	// buffers on the next execution. Disabled by default.
+	void SetHugePages( bool enable );
+	bool GetHugePages( void ) const { return HugePages; }
+
+	// Out-of-core mode, for grids whose buffers don't fit in memory. If directory isn't NULL, the
+	// buffers are memory-mapped files created there (and deleted right away, so nothing is left
+	// behind), and each pass streams through them in bands of rows: the next band is read ahead
+	// while the threads work on the current one, and each finished band is dropped from memory.
+	// memoryCap limits the bytes of the buffers mapped in at once, 0 picking a default. Pages the
+	// kernel keeps in its own cache don't count, since it gives them back when memory runs low.
+	// The tiled traversal and huge pages are not used in this mode. Changing it reallocates the
+	// buffers on the next execution. Disabled by default.
+	void SetOutOfCore( const char* directory, size_t memoryCap );
+	const char* GetOutOfCore( void ) const { return SwapDirectory.empty() ? NULL : SwapDirectory.c_str(); }
+	size_t GetMemoryCap( void ) const { return MemoryCap; }
+
+	// Sets the step schedule (see schedule.h). The variants with extra passes misclassify fewer
+	// pixels at the cost of those passes. The default is plain Jump Flooding.
+	void SetSchedule( StepSchedule schedule ) { Schedule = schedule; }
+	StepSchedule GetSchedule( void ) const { return Schedule; }
+
+	// Number of passes the schedule takes over the last grid, and how many of those it adds
+	// to plain Jump Flooding
+	int NumPasses( void ) const { return NumSteps; }
+	int NumExtraPasses( void ) const { return ::ExtraPasses( Schedule, FirstStep() ); }
+
+	// Step of a pass of the last execution
+	int PassStep( int pass ) const { return Steps[ pass ]; }
+
+	// If enabled, the time each pass takes is recorded, and PassTime() gives it in milliseconds
+	// for the last execution. Disabled by default.
+	void SetPassTiming( bool enable ) { PassTiming = enable; }
+	double PassTime( int pass ) const { return PassTimes[ pass ]; }
+
+	// If enabled, each execution also gathers the area, centroid and bounding box of every seed's
+	// cell. They are accumulated in the last pass, as each of its rows is written, so there is no
+	// separate sweep over the map. Every thread adds its rows into statistics of its own, which
+	// takes memory for every seed on each thread but the first, and the threads then sum them a
+	// range of seeds each, so none of them ever waits on a lock. Disabled by default.
+	void SetCellStats( bool enable ) { CellStatsEnabled = enable; }
+	bool GetCellStats( void ) const { return CellStatsEnabled; }
+
+	// Statistics of the cells of the seeds given to the last Execute(), in the same order, or
+	// NULL if they weren't gathered. Seeds outside the grid have empty cells, and so do all but
+	// the first of several seeds sharing a position, as in GetLabels(). Incremental updates don't
+	// keep them up to date, so there are none after one.
+	const CellStats* CellStatistics( void ) const { return HasStats == true ? &SeedStats[0] : NULL; }
+
+private:
+
+	// Work done by each thread on its own band of rows
+	void InitializeBand( int threadIdx, int numThreads );
+	void FloodBand( int threadIdx, int numThreads );
+
+	// A single pass of the algorithm over rows [yBegin,yEnd) by thread threadIdx. If finalPass is
+	// true, the distances of a running distance transform and the cell statistics are taken from
+	// each row right after it's written.
+	void FloodRows( const Cell* RBuffer, Cell* WBuffer, int step, int yBegin, int yEnd, int threadIdx, bool finalPass );
+
+	// A single pass in out-of-core mode, one band of rows at a time, see SetOutOfCore()
+	void StreamBands( const Cell* RBuffer, Cell* WBuffer, int step, int threadIdx, int numThreads, bool finalPass );
+
+	// Number of rows in each band of StreamBands(), whose reads and writes touch four times as many
+	int StreamRows( void ) const;
+
+	// A single pass over a thread's share of the column tiles, see TRAVERSAL_TILED
+	void FloodTiles( const Cell* RBuffer, Cell* WBuffer, int step, int threadIdx, int numThreads, bool finalPass );
+
+	// A single pass over pixels [xBegin,xEnd) of row y
+	void FloodSpan( const Cell* RBuffer, Cell* WBuffer, int step, int y, int xBegin, int xEnd );
+
+	// A single pass over pixels [xBegin,xEnd) of row y, checking the bounds of every neighbor
+	void FloodBorder( const Cell* RBuffer, Cell* WBuffer, int step, int y, int xBegin, int xEnd );
+
+	// Writes the distances of pixels [xBegin,xEnd) of row y of the map to DistanceOutput
+	void WriteDistances( const Cell* map, int y, int xBegin, int xEnd );
+
+	// Adds pixels [xBegin,xEnd) of row y of the map to the cell statistics of thread threadIdx
+	void AccumulateStats( const Cell* map, int y, int xBegin, int xEnd, int threadIdx );
+
+	// Sums the statistics of every thread into SeedStats, for one range of seeds per thread
+	void MergeStatsBand( int threadIdx, int numThreads );
+
+	// Step of the first plain Jump Flooding pass: half the image's size. If the image isn't
+	// square, we use the largest dimension.
+	int FirstStep( void ) const { return BufferWidth > BufferHeight ? BufferWidth/2 : BufferHeight/2; }
+
+	// Grows the buffers if they can't hold numCells cells. Returns false if they couldn't be created.
+	bool ReserveBuffers( size_t numCells );
+
+	// Empties every pixel of owner and lists them in Region
+	void CollectRegion( Cell* map, const Cell& owner );
+
+	// Gives each pixel in Region the closest of the seeds bordering it. Returns false if there
+	// were none, leaving the pixels empty.
+	bool AssignRegion( Cell* map );
+
+	// Gives owner, sitting at position seed, the pixels connected to it that are closer to it
+	// than to their current seed. Returns false if the seed is outside the map.
+	bool GrowRegion( Cell* map, Point seed, const Cell& owner );
+
+	// Runs one of the band functions above on every thread
+	void RunParallel( void (BasicJumpFlooder::*func)( int, int ) );
+
+	// Not copyable, since we own the buffers
+	BasicJumpFlooder( const BasicJumpFlooder& );
+	BasicJumpFlooder& operator=( const BasicJumpFlooder& );
+
+	// Buffers
+	Cell* BufferA;
+	Cell* BufferB;
+
+	// Buffer dimensions
+	int BufferWidth;
+	int BufferHeight;
+
+	// Which buffer are we reading from?
+	bool ReadingBufferA;
+
+	// Does the buffer we are reading from hold the result of the last execution?
+	bool HasResult;
+
+	// How many cells the buffers can hold, and whether they were allocated with huge pages or
+	// mapped from files
+	size_t BufferCapacity;
+	bool BufferHugePages;
+	bool BufferMapped;
+
+	// Worker threads, or NULL when running on the calling thread only
+	ThreadPool* Pool;
+
+	// Instruction set of the kernel used for the pixels far enough from the edges to need no
+	// bounds checks. The kernel itself is kept by the layout.
+	KernelISA ISA;
+
+	// Traversal order and allocation options
+	Traversal Mode;
+	bool HugePages;
+
+	// Where the buffer files go in out-of-core mode (empty if disabled), and the memory they may use
+	std::string SwapDirectory;
+	size_t MemoryCap;
+
+	// Size of the largest CPU cache, which decides when the tiled traversal kicks in
+	size_t CacheSize;
+
+	// Step schedule, and the step of each pass of the last execution
+	StepSchedule Schedule;
+	int Steps[ MAX_SCHEDULE_PASSES ];
+	int NumSteps;
+
+	// Time of each pass of the last execution, if PassTiming is enabled
+	bool PassTiming;
+	double PassTimes[ MAX_SCHEDULE_PASSES ];
+
+	// Turns cells into seed coordinates
+	Layout Cells;
+
+	// State of the distance transform being run, if DistanceOutput isn't NULL
+	const unsigned char* DistanceMask;
+	void* DistanceOutput;
+	DistanceMode DistMode;
+	DistanceFormat DistFormat;
+	float MaxDistance;
+	std::vector<Point> MaskSeeds;
+
+	// Cell statistics of the last execution, if enabled. The first thread accumulates straight
+	// into SeedStats, and each of the others into its own run of numSeeds entries of
+	// PartialStats, which the merge leaves zeroed for the next execution.
+	bool CellStatsEnabled;
+	bool HasStats;
+	std::vector<CellStats> SeedStats;
+	std::vector<CellStats> PartialStats;
+
+	// Pixels being revisited by an incremental update, and the seeds bordering them
+	std::vector<size_t> Region;
+	std::vector<Cell> Candidates;
+
+};
+
+// Each pixel holds the coordinates of its closest seed
+typedef BasicJumpFlooder< PointLayout > JumpFlooder;
+
+// Each pixel holds the index of its closest seed in the array given to Execute()
+typedef BasicJumpFlooder< IndexLayout<unsigned int> > IndexJumpFlooder;
+
+// The same with 16-bit indices, for fewer than 65536 seeds
+typedef BasicJumpFlooder< IndexLayout<unsigned short> > SmallIndexJumpFlooder;
+
+#endif
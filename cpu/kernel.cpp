@@ -0,0 +1,587 @@
+/*=================================================================================================
+  About: Implementation of the interior kernels declared in kernel.h.
+
+   Each pixel holds a Point, so a vector register holds 2 (SSE4.2), 4 (AVX2) or 8 (AVX-512) pixels
+   with their x and y coordinates interleaved. Coordinate differences are converted to float and
+   squared, the y lanes are added into the x lanes, exactly as SquaredDistance() does, and the sums
+   are copied back into the y lanes so that one comparison mask selects whole points. Pixels
+   without a closest seed get an infinite distance, which makes the selection branchless: a
+   neighbor is adopted only if it is strictly closer, checked in the same order as the scalar code,
+   so ties are resolved identically.
+
+   With the seed index layouts, a register holds 8 (AVX2) or 16 (AVX-512) pixels. The seed
+   coordinates are fetched from the structure-of-arrays table with masked gathers, which skip the
+   pixels without a closest seed. There is no SSE4.2 version of these, since it has no gathers.
+
+   The SIMD functions are compiled for their instruction set with function attributes, so the
+   rest of the program doesn't need any special compiler flags.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <math.h>
+#include <stddef.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+
+#include "kernel.h"
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Offsets of the 8 neighbors of a pixel, in the same order the scalar code visits them:
+//   0 1 2
+//   3 . 4
+//   5 6 7
+static void GetNeighborOffsets( int width, int step, ptrdiff_t offsets[8] ) {
+
+	ptrdiff_t rowStep = (ptrdiff_t)step * width;
+
+	offsets[0] = -rowStep - step;
+	offsets[1] = -rowStep;
+	offsets[2] = -rowStep + step;
+	offsets[3] = -step;
+	offsets[4] =  step;
+	offsets[5] =  rowStep - step;
+	offsets[6] =  rowStep;
+	offsets[7] =  rowStep + step;
+
+}
+
+// Squared distance from (x,y) to a point's closest seed, or infinity if it has none
+static inline float SeedDistance( const Point& p, int x, int y ) {
+
+	if( p.x == -1 || p.y == -1 )
+		return INFINITY;
+
+	return SquaredDistance( p.x - x, p.y - y );
+
+}
+
+static void InteriorScalar( const Point* RBuffer, Point* WBuffer, int width, int y, int step,
+                            int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Point* r = RBuffer + (ptrdiff_t)y * width;
+	Point* w = WBuffer + (ptrdiff_t)y * width;
+
+	for( int x = xBegin; x < xEnd; ++x ) {
+
+		Point best = r[x];
+		float dist = SeedDistance( best, x, y );
+
+		for( int k = 0; k < 8; ++k ) {
+
+			const Point& cand = r[ x + offsets[k] ];
+			float candDist = SeedDistance( cand, x, y );
+
+			if( candDist < dist ) {
+				best = cand;
+				dist = candDist;
+			}
+
+		}
+
+		w[x] = best;
+
+	}
+
+}
+
+// Squared distance from (x,y) to the seed with index c, or infinity if c marks no seed
+template< typename Index >
+static inline float SeedDistance( Index c, const int* seedX, const int* seedY, int x, int y ) {
+
+	if( c == (Index)~(Index)0 )
+		return INFINITY;
+
+	return SquaredDistance( seedX[c] - x, seedY[c] - y );
+
+}
+
+template< typename Index >
+static void IndexInteriorScalar( const Index* RBuffer, Index* WBuffer, const int* seedX, const int* seedY,
+                                 int width, int y, int step, int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Index* r = RBuffer + (ptrdiff_t)y * width;
+	Index* w = WBuffer + (ptrdiff_t)y * width;
+
+	for( int x = xBegin; x < xEnd; ++x ) {
+
+		Index best = r[x];
+		float dist = SeedDistance( best, seedX, seedY, x, y );
+
+		for( int k = 0; k < 8; ++k ) {
+
+			Index cand = r[ x + offsets[k] ];
+			float candDist = SeedDistance( cand, seedX, seedY, x, y );
+
+			if( candDist < dist ) {
+				best = cand;
+				dist = candDist;
+			}
+
+		}
+
+		w[x] = best;
+
+	}
+
+}
+
+#ifdef KERNEL_X86
+
+/*-------------------------------------------------------------------------------------------------
+  SSE4.2: 2 pixels per register
+-------------------------------------------------------------------------------------------------*/
+
+__attribute__(( target( "sse4.2" ) ))
+static inline __m128 DistanceSSE42( __m128i p, __m128i pos, __m128i none, __m128 inf ) {
+
+	__m128 d    = _mm_cvtepi32_ps( _mm_sub_epi32( p, pos ) );
+	__m128 sq   = _mm_mul_ps( d, d );
+	__m128 dist = _mm_add_ps( sq, _mm_castsi128_ps( _mm_srli_epi64( _mm_castps_si128( sq ), 32 ) ) );
+
+	dist = _mm_blendv_ps( dist, inf, _mm_castsi128_ps( _mm_cmpeq_epi32( p, none ) ) );
+
+	return _mm_moveldup_ps( dist );
+
+}
+
+__attribute__(( target( "sse4.2" ) ))
+static void InteriorSSE42( const Point* RBuffer, Point* WBuffer, int width, int y, int step,
+                           int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Point* r = RBuffer + (ptrdiff_t)y * width;
+	Point* w = WBuffer + (ptrdiff_t)y * width;
+
+	const __m128i none    = _mm_set1_epi32( -1 );
+	const __m128  inf     = _mm_set1_ps( INFINITY );
+	const __m128i advance = _mm_setr_epi32( 2, 0, 2, 0 );
+	__m128i pos = _mm_setr_epi32( xBegin, y, xBegin + 1, y );
+
+	int x = xBegin;
+	for( ; x + 2 <= xEnd; x += 2 ) {
+
+		__m128i best = _mm_loadu_si128( (const __m128i*)( r + x ) );
+		__m128  dist = DistanceSSE42( best, pos, none, inf );
+
+		for( int k = 0; k < 8; ++k ) {
+			__m128i cand     = _mm_loadu_si128( (const __m128i*)( r + x + offsets[k] ) );
+			__m128  candDist = DistanceSSE42( cand, pos, none, inf );
+			__m128  closer   = _mm_cmplt_ps( candDist, dist );
+			best = _mm_blendv_epi8( best, cand, _mm_castps_si128( closer ) );
+			dist = _mm_min_ps( candDist, dist );
+		}
+
+		_mm_storeu_si128( (__m128i*)( w + x ), best );
+		pos = _mm_add_epi32( pos, advance );
+
+	}
+
+	// Leftover pixels
+	InteriorScalar( RBuffer, WBuffer, width, y, step, x, xEnd );
+
+}
+
+/*-------------------------------------------------------------------------------------------------
+  AVX2: 4 pixels per register
+-------------------------------------------------------------------------------------------------*/
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256 DistanceAVX2( __m256i p, __m256i pos, __m256i none, __m256 inf ) {
+
+	__m256 d    = _mm256_cvtepi32_ps( _mm256_sub_epi32( p, pos ) );
+	__m256 sq   = _mm256_mul_ps( d, d );
+	__m256 dist = _mm256_add_ps( sq, _mm256_castsi256_ps( _mm256_srli_epi64( _mm256_castps_si256( sq ), 32 ) ) );
+
+	dist = _mm256_blendv_ps( dist, inf, _mm256_castsi256_ps( _mm256_cmpeq_epi32( p, none ) ) );
+
+	return _mm256_moveldup_ps( dist );
+
+}
+
+__attribute__(( target( "avx2" ) ))
+static void InteriorAVX2( const Point* RBuffer, Point* WBuffer, int width, int y, int step,
+                          int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Point* r = RBuffer + (ptrdiff_t)y * width;
+	Point* w = WBuffer + (ptrdiff_t)y * width;
+
+	const __m256i none    = _mm256_set1_epi32( -1 );
+	const __m256  inf     = _mm256_set1_ps( INFINITY );
+	const __m256i advance = _mm256_setr_epi32( 4, 0, 4, 0, 4, 0, 4, 0 );
+	__m256i pos = _mm256_setr_epi32( xBegin, y, xBegin + 1, y, xBegin + 2, y, xBegin + 3, y );
+
+	int x = xBegin;
+	for( ; x + 4 <= xEnd; x += 4 ) {
+
+		__m256i best = _mm256_loadu_si256( (const __m256i*)( r + x ) );
+		__m256  dist = DistanceAVX2( best, pos, none, inf );
+
+		for( int k = 0; k < 8; ++k ) {
+			__m256i cand     = _mm256_loadu_si256( (const __m256i*)( r + x + offsets[k] ) );
+			__m256  candDist = DistanceAVX2( cand, pos, none, inf );
+			__m256  closer   = _mm256_cmp_ps( candDist, dist, _CMP_LT_OQ );
+			best = _mm256_blendv_epi8( best, cand, _mm256_castps_si256( closer ) );
+			dist = _mm256_min_ps( candDist, dist );
+		}
+
+		_mm256_storeu_si256( (__m256i*)( w + x ), best );
+		pos = _mm256_add_epi32( pos, advance );
+
+	}
+
+	// Leftover pixels
+	InteriorScalar( RBuffer, WBuffer, width, y, step, x, xEnd );
+
+}
+
+/*-------------------------------------------------------------------------------------------------
+  AVX2 with seed indices: 8 pixels per register
+-------------------------------------------------------------------------------------------------*/
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i LoadIndicesAVX2( const unsigned int* p ) {
+
+	return _mm256_loadu_si256( (const __m256i*)p );
+
+}
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i LoadIndicesAVX2( const unsigned short* p ) {
+
+	return _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)p ) );
+
+}
+
+__attribute__(( target( "avx2" ) ))
+static inline void StoreIndicesAVX2( unsigned int* p, __m256i v ) {
+
+	_mm256_storeu_si256( (__m256i*)p, v );
+
+}
+
+__attribute__(( target( "avx2" ) ))
+static inline void StoreIndicesAVX2( unsigned short* p, __m256i v ) {
+
+	// Packing works within each 128-bit half, so gather both halves' results into the low one
+	__m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi32( v, v ), 0x08 );
+	_mm_storeu_si128( (__m128i*)p, _mm256_castsi256_si128( packed ) );
+
+}
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256 IndexDistanceAVX2( __m256i c, __m256i none, const int* seedX, const int* seedY,
+                                        __m256i px, __m256i py, __m256 inf ) {
+
+	__m256i empty = _mm256_cmpeq_epi32( c, none );
+	__m256i valid = _mm256_xor_si256( empty, _mm256_set1_epi32( -1 ) );
+	__m256i zero  = _mm256_setzero_si256();
+
+	__m256i sx = _mm256_mask_i32gather_epi32( zero, seedX, c, valid, 4 );
+	__m256i sy = _mm256_mask_i32gather_epi32( zero, seedY, c, valid, 4 );
+
+	__m256 dx = _mm256_cvtepi32_ps( _mm256_sub_epi32( sx, px ) );
+	__m256 dy = _mm256_cvtepi32_ps( _mm256_sub_epi32( sy, py ) );
+	__m256 sum = _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) );
+
+	return _mm256_blendv_ps( sum, inf, _mm256_castsi256_ps( empty ) );
+
+}
+
+template< typename Index >
+__attribute__(( target( "avx2" ) ))
+static void IndexInteriorAVX2( const Index* RBuffer, Index* WBuffer, const int* seedX, const int* seedY,
+                               int width, int y, int step, int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Index* r = RBuffer + (ptrdiff_t)y * width;
+	Index* w = WBuffer + (ptrdiff_t)y * width;
+
+	const __m256i none    = _mm256_set1_epi32( (int)(Index)~(Index)0 );
+	const __m256  inf     = _mm256_set1_ps( INFINITY );
+	const __m256i advance = _mm256_set1_epi32( 8 );
+	const __m256i py      = _mm256_set1_epi32( y );
+	__m256i px = _mm256_add_epi32( _mm256_set1_epi32( xBegin ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+
+	int x = xBegin;
+	for( ; x + 8 <= xEnd; x += 8 ) {
+
+		__m256i best = LoadIndicesAVX2( r + x );
+		__m256  dist = IndexDistanceAVX2( best, none, seedX, seedY, px, py, inf );
+
+		for( int k = 0; k < 8; ++k ) {
+			__m256i cand     = LoadIndicesAVX2( r + x + offsets[k] );
+			__m256  candDist = IndexDistanceAVX2( cand, none, seedX, seedY, px, py, inf );
+			__m256  closer   = _mm256_cmp_ps( candDist, dist, _CMP_LT_OQ );
+			best = _mm256_blendv_epi8( best, cand, _mm256_castps_si256( closer ) );
+			dist = _mm256_min_ps( candDist, dist );
+		}
+
+		StoreIndicesAVX2( w + x, best );
+		px = _mm256_add_epi32( px, advance );
+
+	}
+
+	// Leftover pixels
+	IndexInteriorScalar( RBuffer, WBuffer, seedX, seedY, width, y, step, x, xEnd );
+
+}
+
+/*-------------------------------------------------------------------------------------------------
+  AVX-512: 8 pixels per register
+-------------------------------------------------------------------------------------------------*/
+
+__attribute__(( target( "avx512f" ) ))
+static inline __m512 DistanceAVX512( __m512i p, __m512i pos, __m512i none, __m512 inf ) {
+
+	__m512 d    = _mm512_cvtepi32_ps( _mm512_sub_epi32( p, pos ) );
+	__m512 sq   = _mm512_mul_ps( d, d );
+	__m512 dist = _mm512_add_ps( sq, _mm512_castsi512_ps( _mm512_srli_epi64( _mm512_castps_si512( sq ), 32 ) ) );
+
+	dist = _mm512_mask_blend_ps( _mm512_cmpeq_epi32_mask( p, none ), dist, inf );
+
+	return _mm512_moveldup_ps( dist );
+
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void InteriorAVX512( const Point* RBuffer, Point* WBuffer, int width, int y, int step,
+                            int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Point* r = RBuffer + (ptrdiff_t)y * width;
+	Point* w = WBuffer + (ptrdiff_t)y * width;
+
+	const __m512i none    = _mm512_set1_epi32( -1 );
+	const __m512  inf     = _mm512_set1_ps( INFINITY );
+	const __m512i advance = _mm512_set1_epi64( 8 );
+	__m512i pos = _mm512_setr_epi32( xBegin,     y, xBegin + 1, y, xBegin + 2, y, xBegin + 3, y,
+	                                 xBegin + 4, y, xBegin + 5, y, xBegin + 6, y, xBegin + 7, y );
+
+	int x = xBegin;
+	for( ; x + 8 <= xEnd; x += 8 ) {
+
+		__m512i best = _mm512_loadu_si512( (const void*)( r + x ) );
+		__m512  dist = DistanceAVX512( best, pos, none, inf );
+
+		for( int k = 0; k < 8; ++k ) {
+			__m512i   cand     = _mm512_loadu_si512( (const void*)( r + x + offsets[k] ) );
+			__m512    candDist = DistanceAVX512( cand, pos, none, inf );
+			__mmask16 closer   = _mm512_cmp_ps_mask( candDist, dist, _CMP_LT_OQ );
+			best = _mm512_mask_blend_epi32( closer, best, cand );
+			dist = _mm512_min_ps( candDist, dist );
+		}
+
+		_mm512_storeu_si512( (void*)( w + x ), best );
+		pos = _mm512_add_epi32( pos, advance );
+
+	}
+
+	// Leftover pixels
+	InteriorScalar( RBuffer, WBuffer, width, y, step, x, xEnd );
+
+}
+
+/*-------------------------------------------------------------------------------------------------
+  AVX-512 with seed indices: 16 pixels per register
+-------------------------------------------------------------------------------------------------*/
+
+__attribute__(( target( "avx512f" ) ))
+static inline __m512i LoadIndicesAVX512( const unsigned int* p ) {
+
+	return _mm512_loadu_si512( (const void*)p );
+
+}
+
+__attribute__(( target( "avx512f" ) ))
+static inline __m512i LoadIndicesAVX512( const unsigned short* p ) {
+
+	return _mm512_cvtepu16_epi32( _mm256_loadu_si256( (const __m256i*)p ) );
+
+}
+
+__attribute__(( target( "avx512f" ) ))
+static inline void StoreIndicesAVX512( unsigned int* p, __m512i v ) {
+
+	_mm512_storeu_si512( (void*)p, v );
+
+}
+
+__attribute__(( target( "avx512f" ) ))
+static inline void StoreIndicesAVX512( unsigned short* p, __m512i v ) {
+
+	_mm256_storeu_si256( (__m256i*)p, _mm512_cvtepi32_epi16( v ) );
+
+}
+
+__attribute__(( target( "avx512f" ) ))
+static inline __m512 IndexDistanceAVX512( __m512i c, __m512i none, const int* seedX, const int* seedY,
+                                          __m512i px, __m512i py, __m512 inf ) {
+
+	__mmask16 empty = _mm512_cmpeq_epi32_mask( c, none );
+	__mmask16 valid = _mm512_knot( empty );
+	__m512i   zero  = _mm512_setzero_si512();
+
+	__m512i sx = _mm512_mask_i32gather_epi32( zero, valid, c, seedX, 4 );
+	__m512i sy = _mm512_mask_i32gather_epi32( zero, valid, c, seedY, 4 );
+
+	__m512 dx = _mm512_cvtepi32_ps( _mm512_sub_epi32( sx, px ) );
+	__m512 dy = _mm512_cvtepi32_ps( _mm512_sub_epi32( sy, py ) );
+	__m512 sum = _mm512_add_ps( _mm512_mul_ps( dx, dx ), _mm512_mul_ps( dy, dy ) );
+
+	return _mm512_mask_blend_ps( empty, sum, inf );
+
+}
+
+template< typename Index >
+__attribute__(( target( "avx512f" ) ))
+static void IndexInteriorAVX512( const Index* RBuffer, Index* WBuffer, const int* seedX, const int* seedY,
+                                 int width, int y, int step, int xBegin, int xEnd ) {
+
+	ptrdiff_t offsets[8];
+	GetNeighborOffsets( width, step, offsets );
+
+	const Index* r = RBuffer + (ptrdiff_t)y * width;
+	Index* w = WBuffer + (ptrdiff_t)y * width;
+
+	const __m512i none    = _mm512_set1_epi32( (int)(Index)~(Index)0 );
+	const __m512  inf     = _mm512_set1_ps( INFINITY );
+	const __m512i advance = _mm512_set1_epi32( 16 );
+	const __m512i py      = _mm512_set1_epi32( y );
+	__m512i px = _mm512_add_epi32( _mm512_set1_epi32( xBegin ),
+	                               _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ) );
+
+	int x = xBegin;
+	for( ; x + 16 <= xEnd; x += 16 ) {
+
+		__m512i best = LoadIndicesAVX512( r + x );
+		__m512  dist = IndexDistanceAVX512( best, none, seedX, seedY, px, py, inf );
+
+		for( int k = 0; k < 8; ++k ) {
+			__m512i   cand     = LoadIndicesAVX512( r + x + offsets[k] );
+			__m512    candDist = IndexDistanceAVX512( cand, none, seedX, seedY, px, py, inf );
+			__mmask16 closer   = _mm512_cmp_ps_mask( candDist, dist, _CMP_LT_OQ );
+			best = _mm512_mask_blend_epi32( closer, best, cand );
+			dist = _mm512_min_ps( candDist, dist );
+		}
+
+		StoreIndicesAVX512( w + x, best );
+		px = _mm512_add_epi32( px, advance );
+
+	}
+
+	// Leftover pixels
+	IndexInteriorScalar( RBuffer, WBuffer, seedX, seedY, width, y, step, x, xEnd );
+
+}
+
+#endif // KERNEL_X86
+
+KernelISA DetectKernelISA( void ) {
+
+#ifdef KERNEL_X86
+	__builtin_cpu_init();
+
+	if( __builtin_cpu_supports( "avx512f" ) )
+		return KERNEL_AVX512;
+
+	if( __builtin_cpu_supports( "avx2" ) )
+		return KERNEL_AVX2;
+
+	if( __builtin_cpu_supports( "sse4.2" ) )
+		return KERNEL_SSE42;
+#endif
+
+	return KERNEL_SCALAR;
+
+}
+
+InteriorKernel GetInteriorKernel( KernelISA isa ) {
+
+	switch( isa ) {
+#ifdef KERNEL_X86
+		case KERNEL_AVX512:
+			return &InteriorAVX512;
+
+		case KERNEL_AVX2:
+			return &InteriorAVX2;
+
+		case KERNEL_SSE42:
+			return &InteriorSSE42;
+#endif
+
+		default:
+			return &InteriorScalar;
+	}
+
+}
+
+template<>
+IndexKernel<unsigned int>::Func GetIndexKernel<unsigned int>( KernelISA isa ) {
+
+	switch( isa ) {
+#ifdef KERNEL_X86
+		case KERNEL_AVX512:
+			return &IndexInteriorAVX512<unsigned int>;
+
+		case KERNEL_AVX2:
+			return &IndexInteriorAVX2<unsigned int>;
+#endif
+
+		default:
+			return &IndexInteriorScalar<unsigned int>;
+	}
+
+}
+
+template<>
+IndexKernel<unsigned short>::Func GetIndexKernel<unsigned short>( KernelISA isa ) {
+
+	switch( isa ) {
+#ifdef KERNEL_X86
+		case KERNEL_AVX512:
+			return &IndexInteriorAVX512<unsigned short>;
+
+		case KERNEL_AVX2:
+			return &IndexInteriorAVX2<unsigned short>;
+#endif
+
+		default:
+			return &IndexInteriorScalar<unsigned short>;
+	}
+
+}
+
+const char* KernelISAName( KernelISA isa ) {
+
+	switch( isa ) {
+		case KERNEL_AVX512: return "avx512";
+		case KERNEL_AVX2:   return "avx2";
+		case KERNEL_SSE42:  return "sse4.2";
+		default:            return "scalar";
+	}
+
+}
@@ -0,0 +1,73 @@
+/*=================================================================================================
+  About: Vectorized kernels for the interior of a Jump Flooding pass. The interior of a row is the
+   run of pixels whose 8 neighbors at the current step all lie inside the buffer, so the kernels
+   need no bounds checks; JumpFlooder handles the pixels near the edges itself. The instruction
+   set is picked at runtime, and every kernel gives exactly the same result as the scalar code.
+   There are kernels for each of the buffer layouts in layout.h.
+=================================================================================================*/
+
+#ifndef _KERNEL_H_
+#define _KERNEL_H_
+
+#include "point.h"
+
+/*=================================================================================================
+  TYPES
+=================================================================================================*/
+
+// Instruction sets a kernel can be built for, from slowest to fastest
+enum KernelISA {
+	KERNEL_SCALAR = 0,
+	KERNEL_SSE42,
+	KERNEL_AVX2,
+	KERNEL_AVX512
+};
+
+// Processes pixels [xBegin,xEnd) of row y of a width-wide buffer. The caller guarantees that
+// every neighbor at distance step of those pixels lies inside the buffer.
+typedef void (*InteriorKernel)( const Point* RBuffer, Point* WBuffer, int width, int y, int step,
+                                int xBegin, int xEnd );
+
+// The same for buffers holding seed indices (see IndexLayout in layout.h), where seedX and seedY
+// hold the coordinates of each seed
+template< typename Index >
+struct IndexKernel {
+	typedef void (*Func)( const Index* RBuffer, Index* WBuffer, const int* seedX, const int* seedY,
+	                      int width, int y, int step, int xBegin, int xEnd );
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Squared distance of an offset, as used to compare seeds everywhere. The differences are squared
+// in float, so distances beyond 46340 pixels don't overflow, and the result is the same as
+// converting the exact integer to float for grids of up to 4096 pixels. The kernels repeat these
+// exact operations, and the build disables contracting them into fused multiply-adds, so every
+// instruction set rounds the same way.
+static inline float SquaredDistance( int dx, int dy ) {
+
+	float fx = (float)dx;
+	float fy = (float)dy;
+
+	return fx*fx + fy*fy;
+
+}
+
+// The fastest instruction set supported by this CPU
+KernelISA DetectKernelISA( void );
+
+// The interior kernel for an instruction set, which must be supported by this CPU
+InteriorKernel GetInteriorKernel( KernelISA isa );
+
+// The interior kernel for buffers of 32-bit or 16-bit seed indices
+template< typename Index >
+typename IndexKernel<Index>::Func GetIndexKernel( KernelISA isa );
+
+template<> IndexKernel<unsigned int>::Func GetIndexKernel<unsigned int>( KernelISA isa );
+template<> IndexKernel<unsigned short>::Func GetIndexKernel<unsigned short>( KernelISA isa );
+
+// Human readable name of an instruction set, e.g. "avx2"
+const char* KernelISAName( KernelISA isa );
+
+#endif
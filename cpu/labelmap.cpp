@@ -0,0 +1,328 @@
+/*=================================================================================================
+  About: Implementation of the label map output declared in labelmap.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <utility>
+#include <zlib.h>
+
+#include "jumpflood.h"
+#include "labelmap.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+#define RLE_MAGIC   "JFAR"
+#define RLE_VERSION 1
+
+// Runs buffered before writing them out
+#define RLE_BUFFER_RUNS 65536
+
+// Bytes of compressed image data in each PNG IDAT chunk
+#define PNG_CHUNK_SIZE ( 256 * 1024 )
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+const char* LabelFormatName( LabelFormat format ) {
+
+	switch( format ) {
+		case LABELS_RLE: return "rle";
+		case LABELS_PNG: return "png";
+		default:         return "raw";
+	}
+
+}
+
+LabelFormat LabelFormatFromFilename( const char* filename ) {
+
+	const char* extension = strrchr( filename, '.' );
+	if( extension == NULL )
+		return LABELS_RAW;
+
+	for( int i = 0; i < NUM_LABEL_FORMATS; ++i )
+		if( strcasecmp( extension + 1, LabelFormatName( (LabelFormat)i ) ) == 0 )
+			return (LabelFormat)i;
+
+	return LABELS_RAW;
+
+}
+
+template< class Flooder >
+void GetLabels( const Flooder& flooder, const Point* seeds, int numSeeds, unsigned int* labels ) {
+
+	int width  = flooder.Width();
+	int height = flooder.Height();
+
+	// The seeds inside the grid sorted by position, and by index among those sharing one
+	std::vector< std::pair<unsigned long long, unsigned int> > positions;
+	for( int i = 0; i < numSeeds; ++i )
+		if( seeds[i].x >= 0 && seeds[i].x < width && seeds[i].y >= 0 && seeds[i].y < height )
+			positions.push_back( std::make_pair( (unsigned long long)seeds[i].y * width + seeds[i].x, (unsigned int)i ) );
+
+	std::sort( positions.begin(), positions.end() );
+
+	// Neighboring pixels mostly share their seed, so it's only looked up when it changes
+	Point last = { -1, -1 };
+	unsigned int label = NO_LABEL;
+
+	for( int y = 0; y < height; ++y ) {
+		for( int x = 0; x < width; ++x ) {
+
+			Point p = flooder.NearestSeed( x, y );
+
+			if( p.x != last.x || p.y != last.y ) {
+
+				last  = p;
+				label = NO_LABEL;
+
+				if( p.x != -1 && p.y != -1 ) {
+					unsigned long long key = (unsigned long long)p.y * width + p.x;
+					std::vector< std::pair<unsigned long long, unsigned int> >::const_iterator it =
+						std::lower_bound( positions.begin(), positions.end(), std::make_pair( key, 0u ) );
+					if( it != positions.end() && it->first == key )
+						label = it->second;
+				}
+
+			}
+
+			labels[ (size_t)y * width + x ] = label;
+
+		}
+	}
+
+}
+
+// Stores a 32-bit value in big-endian byte order, as PNG wants it
+static void PutBigEndian( unsigned char* bytes, unsigned int value ) {
+
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+
+}
+
+static bool WritePNGChunk( FILE* file, const char* type, const unsigned char* data, size_t size ) {
+
+	unsigned char header[8], footer[4];
+	PutBigEndian( header, (unsigned int)size );
+	memcpy( header + 4, type, 4 );
+
+	// The CRC covers the type and the data
+	uLong crc = crc32( 0, header + 4, 4 );
+	if( size > 0 )
+		crc = crc32( crc, data, (uInt)size );
+	PutBigEndian( footer, (unsigned int)crc );
+
+	return fwrite( header, sizeof( header ), 1, file ) == 1 &&
+	       ( size == 0 || fwrite( data, size, 1, file ) == 1 ) &&
+	       fwrite( footer, sizeof( footer ), 1, file ) == 1;
+
+}
+
+// Palette entry of a label: one of 1 to 255, spread so that neighboring seeds rarely share one
+static inline unsigned char PaletteIndex( unsigned int label ) {
+
+	if( label == NO_LABEL )
+		return 0;
+
+	return (unsigned char)( 1 + ( ( label * 2654435761u ) >> 16 ) % 255 );
+
+}
+
+static bool WritePNG( FILE* file, const unsigned int* labels, int width, int height ) {
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// 8-bit palette image, with the default compression, filtering and no interlacing
+	unsigned char header[13];
+	PutBigEndian( header, width );
+	PutBigEndian( header + 4, height );
+	header[8]  = 8;
+	header[9]  = 3;
+	header[10] = header[11] = header[12] = 0;
+
+	// Black for pixels without a seed, and bright colors for the seeds
+	unsigned char palette[ 256 * 3 ] = { 0, 0, 0 };
+	for( unsigned int i = 1; i < 256; ++i ) {
+		unsigned int hash = i * 2246822519u;
+		palette[ 3 * i ]     = 56 + ( hash >> 24 ) % 200;
+		palette[ 3 * i + 1 ] = 56 + ( ( hash >> 16 ) & 0xFF ) % 200;
+		palette[ 3 * i + 2 ] = 56 + ( ( hash >> 8 ) & 0xFF ) % 200;
+	}
+
+	bool valid = fwrite( signature, sizeof( signature ), 1, file ) == 1 &&
+	             WritePNGChunk( file, "IHDR", header, sizeof( header ) ) &&
+	             WritePNGChunk( file, "PLTE", palette, sizeof( palette ) );
+
+	// Each row starts with its filter type, none, which suits flat areas of color like these.
+	// The fastest compression level is plenty for them too.
+	z_stream stream;
+	memset( &stream, 0, sizeof( stream ) );
+	if( valid == false || deflateInit( &stream, Z_BEST_SPEED ) != Z_OK )
+		return false;
+
+	std::vector<unsigned char> row( (size_t)width + 1 );
+	std::vector<unsigned char> chunk( PNG_CHUNK_SIZE );
+
+	stream.next_out  = &chunk[0];
+	stream.avail_out = chunk.size();
+
+	for( int y = 0; y <= height && valid; ++y ) {
+
+		// One more round after the last row finishes the stream
+		bool finish = y == height;
+
+		if( finish == false ) {
+			const unsigned int* rowLabels = labels + (size_t)y * width;
+			row[0] = 0;
+			for( int x = 0; x < width; ++x )
+				row[ x + 1 ] = PaletteIndex( rowLabels[x] );
+			stream.next_in  = &row[0];
+			stream.avail_in = row.size();
+		}
+
+		int status = Z_OK;
+		while( valid && ( stream.avail_in > 0 || ( finish && status != Z_STREAM_END ) ) ) {
+
+			status = deflate( &stream, finish ? Z_FINISH : Z_NO_FLUSH );
+			valid = status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR;
+
+			if( valid && ( stream.avail_out == 0 || status == Z_STREAM_END ) ) {
+				valid = WritePNGChunk( file, "IDAT", &chunk[0], chunk.size() - stream.avail_out );
+				stream.next_out  = &chunk[0];
+				stream.avail_out = chunk.size();
+			}
+
+		}
+
+	}
+
+	deflateEnd( &stream );
+
+	return valid && WritePNGChunk( file, "IEND", NULL, 0 );
+
+}
+
+static bool WriteRLE( FILE* file, const unsigned int* labels, int width, int height ) {
+
+	unsigned int header[3] = { RLE_VERSION, (unsigned int)width, (unsigned int)height };
+
+	bool valid = fwrite( RLE_MAGIC, 4, 1, file ) == 1 && fwrite( header, sizeof( header ), 1, file ) == 1;
+
+	// Pairs of label and length
+	std::vector<unsigned int> runs;
+	runs.reserve( 2 * RLE_BUFFER_RUNS );
+
+	size_t numPixels = (size_t)width * height;
+
+	for( size_t i = 0; i < numPixels && valid; ) {
+
+		// Lengths are 32-bit, so a single seed over a huge grid takes several runs
+		unsigned int label = labels[i];
+		size_t end = i + 1;
+		while( end < numPixels && labels[ end ] == label && end - i < 0xFFFFFFFFu )
+			++end;
+
+		runs.push_back( label );
+		runs.push_back( (unsigned int)( end - i ) );
+		i = end;
+
+		if( runs.size() == runs.capacity() || i == numPixels ) {
+			valid = fwrite( &runs[0], sizeof( unsigned int ), runs.size(), file ) == runs.size();
+			runs.clear();
+		}
+
+	}
+
+	return valid;
+
+}
+
+bool WriteLabels( const char* filename, LabelFormat format, const unsigned int* labels, int width, int height ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	bool valid;
+
+	switch( format ) {
+		case LABELS_RLE:
+			valid = WriteRLE( file, labels, width, height );
+			break;
+
+		case LABELS_PNG:
+			valid = WritePNG( file, labels, width, height );
+			break;
+
+		default: {
+			size_t numPixels = (size_t)width * height;
+			valid = fwrite( labels, sizeof( unsigned int ), numPixels, file ) == numPixels;
+			break;
+		}
+	}
+
+	return fclose( file ) == 0 && valid;
+
+}
+
+LabelWriter::LabelWriter( void ) :
+	Format( LABELS_RAW ),
+	Width( 0 ),
+	Height( 0 ),
+	Succeeded( true ) {
+
+}
+
+LabelWriter::~LabelWriter( void ) {
+
+	Wait();
+
+}
+
+bool LabelWriter::Write( const char* filename, LabelFormat format, std::vector<unsigned int>& labels, int width, int height ) {
+
+	bool previous = Wait();
+
+	Filename = filename;
+	Format   = format;
+	Width    = width;
+	Height   = height;
+	Labels.swap( labels );
+
+	Thread = std::thread( &LabelWriter::Run, this );
+
+	return previous;
+
+}
+
+bool LabelWriter::Wait( void ) {
+
+	if( Thread.joinable() )
+		Thread.join();
+
+	return Succeeded;
+
+}
+
+void LabelWriter::Run( void ) {
+
+	Succeeded = WriteLabels( Filename.c_str(), Format, &Labels[0], Width, Height );
+
+}
+
+// The flooders we support
+template void GetLabels( const JumpFlooder&, const Point*, int, unsigned int* );
+template void GetLabels( const IndexJumpFlooder&, const Point*, int, unsigned int* );
+template void GetLabels( const SmallIndexJumpFlooder&, const Point*, int, unsigned int* );
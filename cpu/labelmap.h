@@ -0,0 +1,103 @@
+/*=================================================================================================
+  About: Saving nearest-seed maps to disk as label maps, where each pixel holds the index of its
+   closest seed in the seed array (or NO_LABEL if it has none). Three formats are supported:
+     raw  width * height 32-bit labels, row by row, in the machine's byte order, with no header
+     rle  "JFAR", then the version (1), width and height as 32-bit unsigned ints, then the runs of
+          equal labels over the pixels in row order, each as a 32-bit label and a 32-bit length.
+          Voronoi cells are made of long runs, so these files are far smaller than raw ones.
+     png  An 8-bit palette image, where each seed gets one of 255 colors and pixels without a
+          seed are black, for looking at the result.
+   A LabelWriter encodes and writes label maps on a background thread, so the next map can be
+   computed meanwhile.
+=================================================================================================*/
+
+#ifndef _LABELMAP_H_
+#define _LABELMAP_H_
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "point.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Label of the pixels without a closest seed
+#define NO_LABEL 0xFFFFFFFFu
+
+/*=================================================================================================
+  TYPES
+=================================================================================================*/
+
+enum LabelFormat {
+	LABELS_RAW = 0,
+	LABELS_RLE,
+	LABELS_PNG,
+	NUM_LABEL_FORMATS
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// "raw", "rle" or "png"
+const char* LabelFormatName( LabelFormat format );
+
+// The format a file name's extension asks for, raw if it's none of the above
+LabelFormat LabelFormatFromFilename( const char* filename );
+
+// Fills labels (width * height values) with the index of each pixel's closest seed in the last
+// nearest-seed map of a flooder. If several seeds share a position, the first one is used.
+template< class Flooder >
+void GetLabels( const Flooder& flooder, const Point* seeds, int numSeeds, unsigned int* labels );
+
+// Writes a label map in the given format. Returns false if the file couldn't be written.
+bool WriteLabels( const char* filename, LabelFormat format, const unsigned int* labels, int width, int height );
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+class LabelWriter {
+
+public:
+
+	LabelWriter( void );
+
+	// Waits for the write in progress
+	~LabelWriter( void );
+
+	// Starts writing a label map on the background thread, after waiting for the previous one.
+	// labels is swapped with the buffer of the previous map, so the caller gets that buffer back
+	// to fill next, and the two are reused without further allocation. Returns whether the
+	// previous write succeeded.
+	bool Write( const char* filename, LabelFormat format, std::vector<unsigned int>& labels, int width, int height );
+
+	// Waits for the write in progress, if any. Returns false if it failed.
+	bool Wait( void );
+
+private:
+
+	void Run( void );
+
+	// Not copyable, since we own the thread
+	LabelWriter( const LabelWriter& );
+	LabelWriter& operator=( const LabelWriter& );
+
+	std::thread Thread;
+
+	// The map being written
+	std::string Filename;
+	LabelFormat Format;
+	std::vector<unsigned int> Labels;
+	int Width;
+	int Height;
+
+	// Result of the last write
+	bool Succeeded;
+
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*=================================================================================================
+  About: Buffer layouts for BasicJumpFlooder. A layout decides what each pixel of the ping-pong
+   buffers stores to identify its closest seed, and how to get back to that seed's coordinates.
+   The flooder is a template over its layout, so the choice is made at compile time and the
+   flooding loop is the same for all of them.
+=================================================================================================*/
+
+#ifndef _LAYOUT_H_
+#define _LAYOUT_H_
+
+#include <utility>
+#include <vector>
+
+#include "kernel.h"
+#include "point.h"
+
+/*=================================================================================================
+  STRUCTS
+=================================================================================================*/
+
+// The first of the seeds at each position, kept in an open-addressing hash table
+struct SeedPositionTable {
+
+	void Build( const Point* seeds, int numSeeds ) {
+
+		// At most half full, so probes stay short
+		int bits = 1;
+		while( ( 1ull << bits ) < 2ull * numSeeds )
+			++bits;
+
+		Shift = 64 - bits;
+		Slots.assign( 1ull << bits, std::make_pair( 0ull, -1 ) );
+
+		for( int i = 0; i < numSeeds; ++i ) {
+			unsigned long long key = Key( seeds[i] );
+			size_t slot = Probe( key );
+			if( Slots[ slot ].second == -1 )
+				Slots[ slot ] = std::make_pair( key, i );
+		}
+
+	}
+
+	// Index of the first seed at p, or -1 if there is none
+	int Find( const Point& p ) const { return Slots[ Probe( Key( p ) ) ].second; }
+
+	// Asks for the slot Find() starts at to be brought into the cache
+	void Prefetch( const Point& p ) const { __builtin_prefetch( &Slots[ Home( Key( p ) ) ], 0, 3 ); }
+
+	static unsigned long long Key( const Point& p ) {
+		return (unsigned long long)(unsigned int)p.y << 32 | (unsigned int)p.x;
+	}
+
+	// The slot holding key, or the empty one where it would go
+	size_t Probe( unsigned long long key ) const {
+
+		size_t mask = Slots.size() - 1;
+		size_t slot = Home( key );
+
+		while( Slots[ slot ].second != -1 && Slots[ slot ].first != key )
+			slot = ( slot + 1 ) & mask;
+
+		return slot;
+
+	}
+
+	// The slot a key is looked for first
+	size_t Home( unsigned long long key ) const { return ( key * 0x9E3779B97F4A7C15ull ) >> Shift; }
+
+	// (key,index) pairs, with an index of -1 in empty slots
+	std::vector< std::pair<unsigned long long, int> > Slots;
+	int Shift;
+
+};
+
+// Each pixel stores the coordinates of its closest seed, taking 8 bytes
+struct PointLayout {
+
+	typedef Point Cell;
+
+	PointLayout( void ) : Kernel( GetInteriorKernel( KERNEL_SCALAR ) ) {}
+
+	// Called with the seeds before they are flooded. Returns false if they can't be represented.
+	bool SetSeeds( const Point* seeds, int numSeeds ) { return true; }
+
+	// The cell of the i-th seed, which sits at p, and the cell of a pixel with no closest seed yet
+	Cell Make( int i, const Point& p ) const { return p; }
+	Cell Empty( void ) const { Cell c = { -1, -1 }; return c; }
+
+	bool IsEmpty( const Cell& c ) const { return c.x == -1 || c.y == -1; }
+
+	// Do two cells identify the same seed?
+	bool Equal( const Cell& a, const Cell& b ) const { return a.x == b.x && a.y == b.y; }
+
+	// The cell after the seed with index removed was erased from the seed array
+	Cell Renumber( const Cell& c, int removed ) const { return c; }
+
+	// Coordinates of a cell's seed, which must not be empty
+	int X( const Cell& c ) const { return c.x; }
+	int Y( const Cell& c ) const { return c.y; }
+
+	// Index of a cell's seed, which must not be empty, in the seeds given to IndexSeeds(). Cells
+	// only hold coordinates, so they are looked up by position, which gives the first of several
+	// seeds sharing one, as in GetLabels(). FirstSeed() gives that seed for any seed index.
+	void IndexSeeds( const Point* seeds, int numSeeds ) { Positions.Build( seeds, numSeeds ); }
+	int SeedIndex( const Cell& c ) const { return Positions.Find( c ); }
+	void PrefetchSeedIndex( const Cell& c ) const { Positions.Prefetch( c ); }
+	int FirstSeed( int i ) const { return i; }
+
+	void SetKernelISA( KernelISA isa ) { Kernel = GetInteriorKernel( isa ); }
+
+	void Interior( const Cell* RBuffer, Cell* WBuffer, int width, int y, int step, int xBegin, int xEnd ) const {
+		Kernel( RBuffer, WBuffer, width, y, step, xBegin, xEnd );
+	}
+
+	InteriorKernel Kernel;
+
+	SeedPositionTable Positions;
+
+};
+
+// Each pixel stores the index of its closest seed, taking 4 bytes for unsigned int or 2 bytes for
+// unsigned short. The coordinates of the seeds are kept in a separate structure-of-arrays table.
+// The largest index value marks pixels without a closest seed, so 16-bit indices allow for up to
+// 65535 seeds.
+template< typename Index >
+struct IndexLayout {
+
+	typedef Index Cell;
+
+	static const Index EMPTY = (Index)~(Index)0;
+
+	IndexLayout( void ) : Kernel( GetIndexKernel<Index>( KERNEL_SCALAR ) ) {}
+
+	bool SetSeeds( const Point* seeds, int numSeeds ) {
+
+		if( (unsigned long long)numSeeds > EMPTY )
+			return false;
+
+		SeedX.resize( numSeeds );
+		SeedY.resize( numSeeds );
+
+		for( int i = 0; i < numSeeds; ++i ) {
+			SeedX[i] = seeds[i].x;
+			SeedY[i] = seeds[i].y;
+		}
+
+		return true;
+
+	}
+
+	Cell Make( int i, const Point& p ) const { return (Index)i; }
+	Cell Empty( void ) const { return EMPTY; }
+
+	bool IsEmpty( Cell c ) const { return c == EMPTY; }
+
+	bool Equal( Cell a, Cell b ) const { return a == b; }
+
+	// The seeds after the removed one move down by one
+	Cell Renumber( Cell c, int removed ) const { return c != EMPTY && c > (Index)removed ? c - 1 : c; }
+
+	int X( Cell c ) const { return SeedX[c]; }
+	int Y( Cell c ) const { return SeedY[c]; }
+
+	// The cells are the indices. Of several seeds sharing a position, the last one holds their
+	// pixels, while FirstSeed() gives the first, as GetLabels() uses.
+	void IndexSeeds( const Point* seeds, int numSeeds ) {
+
+		SeedPositionTable positions;
+		positions.Build( seeds, numSeeds );
+
+		FirstIndex.resize( numSeeds );
+		for( int i = 0; i < numSeeds; ++i )
+			FirstIndex[i] = positions.Find( seeds[i] );
+
+	}
+
+	int SeedIndex( Cell c ) const { return c; }
+	void PrefetchSeedIndex( Cell c ) const {}
+	int FirstSeed( int i ) const { return FirstIndex[i]; }
+
+	void SetKernelISA( KernelISA isa ) { Kernel = GetIndexKernel<Index>( isa ); }
+
+	void Interior( const Cell* RBuffer, Cell* WBuffer, int width, int y, int step, int xBegin, int xEnd ) const {
+		Kernel( RBuffer, WBuffer, &SeedX[0], &SeedY[0], width, y, step, xBegin, xEnd );
+	}
+
+	// Seed coordinates
+	std::vector<int> SeedX;
+	std::vector<int> SeedY;
+
+	// First seed at the position of each seed, see IndexSeeds()
+	std::vector<int> FirstIndex;
+
+	typename IndexKernel<Index>::Func Kernel;
+
+};
+
+#endif
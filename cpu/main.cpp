@@ -6,18 +6,28 @@
    Flooding in GPU With Applications to Voronoi Diagram and Distance Transform" [Rong 2006]. The
    result is a Voronoi diagram generated from a number of seeds which the user provides with mouse
    clicks. You can also click on and drag around a seed to reposition it, if that's your thing.
+   Once the diagram exists, moving, adding and removing seeds updates it incrementally. Each new
+   diagram is colored on every hardware thread into a texture, uploaded through a pixel buffer
+   object, so redrawing the window only takes a single textured quad.
 =================================================================================================*/
 
 /*=================================================================================================
   INCLUDES
 =================================================================================================*/
 
+// Pixel buffer objects are core in OpenGL 2.1, and libGL exports their functions
+#define GL_GLEXT_PROTOTYPES
+
 #include <GL/glut.h>
+#include <GL/glext.h>
 
 #include <assert.h>
 #include <stdio.h>
 #include <vector>
 
+#include "jumpflood.h"
+#include "threadpool.h"
+
 using namespace std;
 
 /*=================================================================================================
@@ -32,15 +42,6 @@ using namespace std;
 #define INIT_WINDOW_POS_X 0
 #define INIT_WINDOW_POS_Y 0
 
-/*=================================================================================================
-  STRUCTS
-=================================================================================================*/
-
-// Represents a point with (x,y) coordinates
-typedef struct {
-	int x,y;
-} Point;
-
 /*=================================================================================================
   GLOBALS
 =================================================================================================*/
@@ -58,20 +59,30 @@ int CurSeedIdx = -1;
 // How large to draw each seed, used with glPointSize()
 int SeedSize = 8;
 
-// Buffers
-Point* BufferA = NULL;
-Point* BufferB = NULL;
+// Owns the buffers and runs the algorithm
+JumpFlooder Flooder;
 
 // Buffer dimensions
 int BufferWidth  = INIT_WINDOW_WIDTH;
 int BufferHeight = INIT_WINDOW_HEIGHT;
 
-// Which buffer are we reading from?
-bool ReadingBufferA = true;
-
 // Is the window currently fullscreen?
 bool FullScreen = false;
 
+// The diagram as a texture, its dimensions, and whether it is older than the diagram
+GLuint DiagramTexture = 0;
+int TextureWidth  = 0;
+int TextureHeight = 0;
+bool DiagramChanged = false;
+
+// Pixel buffer object the texture is uploaded from, or 0 if they aren't supported, in which case
+// the colors go through TextureColors
+GLuint PixelBuffer = 0;
+vector<unsigned int> TextureColors;
+
+// Threads that color the diagram
+ThreadPool* ColorPool = NULL;
+
 // Pop-up menu
 int MenuId;
 enum MenuEntries {
@@ -89,15 +100,8 @@ enum MenuEntries {
 // If the buffers exist, delete them
 void ClearBuffers( void ) {
 
-	if( BufferA != NULL ) {
-		free( BufferA );
-		BufferA = NULL;
-	}
-
-	if( BufferB != NULL ) {
-		free( BufferB );
-		BufferB = NULL;
-	}
+	Flooder.Clear();
+	DiagramChanged = true;
 
 }
 
@@ -112,130 +116,97 @@ void ExecuteJumpFlooding( void ) {
 
 	printf( "Executing the Jump Flooding algorithm...\n" );
 
-	// Clear the buffers before we start
-	ClearBuffers();
+	Flooder.Execute( &Seeds[0], Seeds.size(), BufferWidth, BufferHeight );
+	DiagramChanged = true;
 
-	// Allocate memory for the two buffers
-	BufferA = (Point*)malloc( sizeof( Point ) * BufferWidth * BufferHeight );
-	BufferB = (Point*)malloc( sizeof( Point ) * BufferWidth * BufferHeight );
+	printf( "Done in %i passes (%i more than plain Jump Flooding).\n", Flooder.NumPasses(), Flooder.NumExtraPasses() );
 
-	assert( BufferA != NULL && BufferB != NULL );
+}
 
-	// Initialize BufferA with (-1,-1), indicating an invalid closest seed.
-	// We don't need to initialize BufferB because it will be written to in the first round.
-	for( int y = 0; y < BufferHeight; ++y ) {
-		for( int x = 0; x < BufferWidth; ++x ) {
-			int idx = ( y * BufferWidth ) + x;
-			BufferA[ idx ].x = -1;
-			BufferA[ idx ].y = -1;
-		}
-	}
+// Index of the seed drawn at buffer position (x,y), or -1 if there is none
+int FindSeed( int x, int y ) {
 
-	// Put the seeds into the first buffer
 	for( int i = 0; i < Seeds.size(); ++i ) {
-		Point& p = Seeds[i];
-		BufferA[ ( p.y * BufferWidth ) + p.x ] = p;
-	}
 
-	// Initial step length is half the image's size. If the image isn't square,
-	// we use the largest dimension.
-	int step = BufferWidth > BufferHeight ? BufferWidth/2 : BufferHeight/2;
-
-	// We use this boolean to know which buffer we are reading from
-	ReadingBufferA = true;
-
-	// We read from the RBuffer and write into the WBuffer
-	Point* RBuffer;
-	Point* WBuffer;
-
-	// Carry out the rounds of Jump Flooding
-	while( step >= 1 ) {
-
-		// Set which buffers we'll be using
-		if( ReadingBufferA == true ) {
-			RBuffer = BufferA;
-			WBuffer = BufferB;
-		}
-		else {
-			RBuffer = BufferB;
-			WBuffer = BufferA;
-		}
-
-		// Iterate over each point to find its closest seed
-		for( int y = 0; y < BufferHeight; ++y ) {
-			for( int x = 0; x < BufferWidth; ++x ) {
+		Point& p = Seeds[i];
 
-				// The point's absolute index in the buffer
-				int idx = ( y * BufferWidth ) + x;
+		float dist = (x-p.x)*(x-p.x) + (y-p.y)*(y-p.y);
 
-				// The point's current closest seed (if any)
-				Point& p = RBuffer[ idx ];
+		if( dist <= SeedSize*SeedSize )
+			return i;
 
-				// Go ahead and write our current closest seed, if any. If we don't do this
-				// we might lose this information if we don't update our seed this round.
-				WBuffer[ idx ] = p;
+	}
 
-				// This is a seed, so skip this point
-				if( p.x == x && p.y == y )
-					continue;
+	return -1;
 
-				// This variable will be used to judge which seed is closest
-				float dist;
+}
 
-				if( p.x == -1 || p.y == -1 )
-					dist = -1; // No closest seed has been found yet
-				else
-					dist = (p.x-x)*(p.x-x) + (p.y-y)*(p.y-y); // Current closest seed's distance
+// Colors a band of rows of the diagram into RGBA pixels, one band per thread
+void ColorBand( void* arg, int threadIdx, int numThreads ) {
 
-				// To find each point's closest seed, we look at its 8 neighbors thusly:
-				//   (x-step,y-step) (x,y-step) (x+step,y-step)
-				//   (x-step,y     ) (x,y     ) (x+step,y     )
-				//   (x-step,y+step) (x,y+step) (x+step,y+step)
+	unsigned int* colors = (unsigned int*)arg;
+	const Point* Buffer = Flooder.Result();
 
-				for( int ky = -1; ky <= 1; ++ky ) {
-					for( int kx = -1; kx <= 1; ++kx ) {
+	int yBegin = (int)( (long long)BufferHeight * threadIdx / numThreads );
+	int yEnd   = (int)( (long long)BufferHeight * ( threadIdx + 1 ) / numThreads );
 
-						// Calculate neighbor's row and column
-						int ny = y + ky * step;
-						int nx = x + kx * step;
+	for( int y = yBegin; y < yEnd; ++y ) {
+		for( int x = 0; x < BufferWidth; ++x ) {
 
-						// If the neighbor is outside the bounds of the buffer, skip it
-						if( nx < 0 || nx >= BufferWidth || ny < 0 || ny >= BufferHeight )
-							continue;
+			size_t idx = (size_t)y * BufferWidth + x;
+			const Point& p = Buffer[ idx ];
 
-						// Calculate neighbor's absolute index
-						int nidx = ( ny * BufferWidth ) + nx;
+			// Calculate color using seed positions for now. Pixels without a seed are black.
+			unsigned char* rgba = (unsigned char*)&colors[ idx ];
+			rgba[0] = p.x < 0 ? 0 : (unsigned char)( 255 * p.x / BufferWidth );
+			rgba[1] = p.y < 0 ? 0 : (unsigned char)( 255 * p.y / BufferHeight );
+			rgba[2] = 0;
+			rgba[3] = 255;
 
-						// Retrieve the neighbor
-						Point& pk = RBuffer[ nidx ];
+		}
+	}
 
-						// If the neighbor doesn't have a closest seed yet, skip it
-						if( pk.x == -1 || pk.y == -1 )
-							continue;
+}
 
-						// Calculate the distance from us to the neighbor's closest seed
-						float newDist = (pk.x-x)*(pk.x-x) + (pk.y-y)*(pk.y-y);
+// Colors the current diagram into the texture. The threads write straight into the pixel
+// buffer object, and the texture is then filled from it by the driver.
+void UpdateTexture( void ) {
 
-						// If dist is -1, it means we have no closest seed, so we might as well take this one
-						// Otherwise, only adopt this new seed if it's closer than our current closest seed
-						if( dist == -1 || newDist < dist ) {
-							WBuffer[ idx ] = pk;
-							dist = newDist;
-						}
+	glBindTexture( GL_TEXTURE_2D, DiagramTexture );
 
-					}
-				}
+	// Grids of a new size need new storage
+	if( TextureWidth != BufferWidth || TextureHeight != BufferHeight ) {
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, BufferWidth, BufferHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+		TextureWidth  = BufferWidth;
+		TextureHeight = BufferHeight;
+	}
 
-			}
-		}
+	size_t size = (size_t)BufferWidth * BufferHeight * sizeof( unsigned int );
+	unsigned int* colors = NULL;
 
-		// Halve the step.
-		step /= 2;
+	if( PixelBuffer != 0 ) {
+		// Orphaning the old storage means we never wait for an upload still in flight
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, PixelBuffer );
+		glBufferData( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+		colors = (unsigned int*)glMapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+	}
+	else {
+		TextureColors.resize( (size_t)BufferWidth * BufferHeight );
+		colors = &TextureColors[0];
+	}
 
-		// Swap the buffers for the next round
-		ReadingBufferA = !ReadingBufferA;
+	if( colors != NULL )
+		ColorPool->Run( &ColorBand, colors );
 
+	if( PixelBuffer != 0 ) {
+		glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+		if( colors != NULL )
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, BufferWidth, BufferHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0 );
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
 	}
+	else
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, BufferWidth, BufferHeight, GL_RGBA, GL_UNSIGNED_BYTE, colors );
+
 }
 
 // Renders the next frame and puts it on the display
@@ -244,39 +215,31 @@ void DisplayFunc( void ) {
 	// Clear the window.
 	glClear( GL_COLOR_BUFFER_BIT );
 
-	// Draw the buffer, if possible
-	Point* Buffer = ReadingBufferA == true ? BufferA : BufferB;
-	if( Buffer != NULL ) {
-
-		glPointSize( 1 );
-		glBegin( GL_POINTS );
-			for( int y = 0; y < WindowHeight; ++y ) {
-				for( int x = 0; x < WindowWidth; ++x ) {
-
-					// The window might not be the same size as the buffer, so
-					// we need to find which point corresponds to this pixel.
+	// Draw the buffer, if possible. It is only colored again when it has changed.
+	if( Flooder.Result() != NULL ) {
 
-					float fx = (float)x / WindowWidth;
-					float fy = (float)y / WindowHeight;
+		if( DiagramChanged )
+			UpdateTexture();
 
-					int bx = fx * BufferWidth;
-					int by = fy * BufferHeight;
+		// The window might not be the same size as the buffer, so the texture is stretched
+		// over it, each pixel showing the nearest point of the buffer
+		glEnable( GL_TEXTURE_2D );
+		glBindTexture( GL_TEXTURE_2D, DiagramTexture );
+		glColor3f( 1.0f, 1.0f, 1.0f );
 
-					int idx = by * BufferWidth + bx;
-
-					// Calculate color using seed positions for now
-					glColor3f( (float)Buffer[idx].x / BufferWidth,
-					           (float)Buffer[idx].y / BufferHeight,
-					           0.0f );
-
-					glVertex2f( fx, fy );
-
-				}
-			}
+		glBegin( GL_QUADS );
+			glTexCoord2f( 0.0f, 0.0f ); glVertex2f( 0.0f, 0.0f );
+			glTexCoord2f( 1.0f, 0.0f ); glVertex2f( 1.0f, 0.0f );
+			glTexCoord2f( 1.0f, 1.0f ); glVertex2f( 1.0f, 1.0f );
+			glTexCoord2f( 0.0f, 1.0f ); glVertex2f( 0.0f, 1.0f );
 		glEnd();
 
+		glDisable( GL_TEXTURE_2D );
+
 	}
 
+	DiagramChanged = false;
+
 	// Draw the seeds
 	glPointSize( SeedSize );
 	glColor3f( 0.0f, 0.0f, 1.0f );
@@ -341,6 +304,16 @@ void KeyboardFunc( unsigned char key, int x, int y ) {
 			ExecuteJumpFlooding();
 			break;
 
+		// s switches to the next step schedule, and updates the diagram if there is one
+		case 's': {
+			StepSchedule schedule = (StepSchedule)( ( Flooder.GetSchedule() + 1 ) % NUM_SCHEDULES );
+			Flooder.SetSchedule( schedule );
+			printf( "Step schedule: %s.\n", StepScheduleName( schedule ) );
+			if( Flooder.Result() != NULL )
+				ExecuteJumpFlooding();
+			break;
+		}
+
 		// f enters and leaves fullscreen mode
 		case 'f':
 			FullScreen = !FullScreen;
@@ -375,11 +348,14 @@ void MouseFunc( int button, int state, int x, int y ) {
 			int by = fy * BufferHeight;
 
 			// Get a pointer to the buffer we're currently using
-			Point* Buffer = ReadingBufferA == true ? BufferA : BufferB;
+			const Point* Buffer = Flooder.Result();
 
-			// If the Voronoi diagram has yet to be created, add a seed
-			// Otherwise, check if one of the seeds has been selected
-			if( Buffer == NULL ) {
+			// If the Voronoi diagram has been created, check if one of the seeds has been selected
+			if( Buffer != NULL )
+				CurSeedIdx = FindSeed( bx, by );
+
+			// Otherwise add a seed, updating the diagram if there is one
+			if( CurSeedIdx == -1 ) {
 
 				printf( "Creating new seed at (%i,%i).", x, y );
 
@@ -388,21 +364,9 @@ void MouseFunc( int button, int state, int x, int y ) {
 
 				printf( " %zi seeds total.\n", Seeds.size() );
 
-			}
-			else {
-
-				// Has one of the seeds been selected?
-				for( int i = 0; i < Seeds.size(); ++i ) {
-
-					Point& p = Seeds[i];
-
-					float dist = (bx-p.x)*(bx-p.x) + (by-p.y)*(by-p.y);
-
-					if( dist <= SeedSize*SeedSize ) {
-						CurSeedIdx = i;
-						break;
-					}
-
+				if( Buffer != NULL ) {
+					Flooder.AddSeed( &Seeds[0], Seeds.size() );
+					DiagramChanged = true;
 				}
 
 			}
@@ -410,17 +374,31 @@ void MouseFunc( int button, int state, int x, int y ) {
 		}
 		else { // state == GLUT_UP
 
-			if( CurSeedIdx != -1 ) {
+			// There's no longer a seed selected. The diagram was kept up to date while dragging.
+			CurSeedIdx = -1;
 
-				// Recreate the Voronoi diagram
-				ExecuteJumpFlooding();
+		}
+	}
 
-				// There's no longer a seed selected
-				CurSeedIdx = -1;
+	// The middle button removes a seed from the diagram
+	if( button == 1 && state == GLUT_DOWN && Flooder.Result() != NULL ) {
 
-			}
+		float fx = (float)x / WindowWidth;
+		float fy = (float)y / WindowHeight;
+
+		int i = FindSeed( fx * BufferWidth, fy * BufferHeight );
+		if( i != -1 && Seeds.size() > 1 ) {
+
+			Point removed = Seeds[i];
+			Seeds.erase( Seeds.begin() + i );
+
+			printf( "Removing seed at (%i,%i). %zi seeds total.\n", removed.x, removed.y, Seeds.size() );
+
+			Flooder.RemoveSeed( &Seeds[0], Seeds.size(), i, removed );
+			DiagramChanged = true;
 
 		}
+
 	}
 
 	// Request a redisplay
@@ -442,9 +420,14 @@ void MotionFunc( int x, int y ) {
 		int by = fy * BufferHeight;
 
 		// Update it with its new position
+		Point from = Seeds[ CurSeedIdx ];
 		Seeds[ CurSeedIdx ].x = bx;
 		Seeds[ CurSeedIdx ].y = by;
 
+		// Only the pixels around its old and new positions need to change
+		Flooder.MoveSeed( &Seeds[0], Seeds.size(), CurSeedIdx, from );
+		DiagramChanged = true;
+
 		// Request a redisplay
 		glutPostRedisplay();
 
@@ -491,6 +474,22 @@ void MenuFunc( int value ) {
 // Initializes variables and OpenGL settings
 void Initialize( void ) {
 
+	// Use every hardware thread to execute the algorithm and to color its result
+	Flooder.SetNumThreads( 0 );
+	ColorPool = new ThreadPool( 0 );
+
+	// The diagram's texture, which shows each buffer pixel as a block of window pixels
+	glGenTextures( 1, &DiagramTexture );
+	glBindTexture( GL_TEXTURE_2D, DiagramTexture );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	if( glutExtensionSupported( "GL_ARB_pixel_buffer_object" ) )
+		glGenBuffers( 1, &PixelBuffer );
+
 	// Set the background color to white
 	glClearColor( 1.0f, 1.0f, 1.0f, 1.0f );
 
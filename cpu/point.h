@@ -0,0 +1,13 @@
+/*=================================================================================================
+  About: The Point type shared by the Jump Flooding core and its kernels.
+=================================================================================================*/
+
+#ifndef _POINT_H_
+#define _POINT_H_
+
+// Represents a point with (x,y) coordinates
+typedef struct {
+	int x,y;
+} Point;
+
+#endif
@@ -0,0 +1,88 @@
+/*=================================================================================================
+  About: Implementation of the step schedules declared in schedule.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <string.h>
+
+#include "schedule.h"
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Appends the plain Jump Flooding steps, halving from firstStep down to 1
+static int AppendJumpFlooding( int firstStep, int* steps ) {
+
+	int numPasses = 0;
+
+	for( int step = firstStep; step >= 1; step /= 2 )
+		steps[ numPasses++ ] = step;
+
+	return numPasses;
+
+}
+
+int GetStepSchedule( StepSchedule schedule, int firstStep, int steps[ MAX_SCHEDULE_PASSES ] ) {
+
+	int numPasses = 0;
+
+	if( schedule == SCHEDULE_1_JFA )
+		steps[ numPasses++ ] = 1;
+
+	numPasses += AppendJumpFlooding( firstStep, steps + numPasses );
+
+	switch( schedule ) {
+		case SCHEDULE_JFA_1:
+			steps[ numPasses++ ] = 1;
+			break;
+
+		case SCHEDULE_JFA_2:
+			steps[ numPasses++ ] = 2;
+			steps[ numPasses++ ] = 1;
+			break;
+
+		case SCHEDULE_JFA_SQUARED:
+			numPasses += AppendJumpFlooding( firstStep, steps + numPasses );
+			break;
+
+		default:
+			break;
+	}
+
+	return numPasses;
+
+}
+
+int ExtraPasses( StepSchedule schedule, int firstStep ) {
+
+	int steps[ MAX_SCHEDULE_PASSES ];
+
+	return GetStepSchedule( schedule, firstStep, steps ) - GetStepSchedule( SCHEDULE_JFA, firstStep, steps );
+
+}
+
+const char* StepScheduleName( StepSchedule schedule ) {
+
+	switch( schedule ) {
+		case SCHEDULE_JFA_1:       return "jfa+1";
+		case SCHEDULE_JFA_2:       return "jfa+2";
+		case SCHEDULE_1_JFA:       return "1+jfa";
+		case SCHEDULE_JFA_SQUARED: return "jfa^2";
+		default:                   return "jfa";
+	}
+
+}
+
+StepSchedule FindStepSchedule( const char* name ) {
+
+	for( int i = 0; i < NUM_SCHEDULES; ++i )
+		if( strcmp( name, StepScheduleName( (StepSchedule)i ) ) == 0 )
+			return (StepSchedule)i;
+
+	return NUM_SCHEDULES;
+
+}
@@ -0,0 +1,53 @@
+/*=================================================================================================
+  About: Step schedules for Jump Flooding. Plain Jump Flooding halves the step from about half the
+   grid size down to 1, which leaves a small number of pixels with the wrong closest seed. The
+   variants from "Variants of Jump Flooding Algorithm for Computing Discrete Voronoi Diagrams"
+   [Rong & Tan 2007] add passes to fix most of them:
+     JFA+1  plain JFA followed by a pass of step 1
+     JFA+2  plain JFA followed by passes of step 2 and 1
+     1+JFA  a pass of step 1 followed by plain JFA
+     JFA^2  plain JFA done twice
+   Each extra pass costs as much as any other, so the extra cost of a variant is simply the
+   number of passes it adds. This header is shared by the CPU and GPU implementations.
+=================================================================================================*/
+
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// The most passes any schedule can take, with steps of up to 2^31
+#define MAX_SCHEDULE_PASSES 66
+
+/*=================================================================================================
+  TYPES
+=================================================================================================*/
+
+enum StepSchedule {
+	SCHEDULE_JFA = 0,
+	SCHEDULE_JFA_1,
+	SCHEDULE_JFA_2,
+	SCHEDULE_1_JFA,
+	SCHEDULE_JFA_SQUARED,
+	NUM_SCHEDULES
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Fills steps with the step of each pass of a schedule whose plain Jump Flooding passes start at
+// firstStep, and returns the number of passes
+int GetStepSchedule( StepSchedule schedule, int firstStep, int steps[ MAX_SCHEDULE_PASSES ] );
+
+// How many more passes a schedule takes than plain Jump Flooding starting at firstStep
+int ExtraPasses( StepSchedule schedule, int firstStep );
+
+// Human readable name of a schedule, e.g. "jfa+1", and the schedule with that name. Unknown
+// names give NUM_SCHEDULES.
+const char* StepScheduleName( StepSchedule schedule );
+StepSchedule FindStepSchedule( const char* name );
+
+#endif
@@ -0,0 +1,203 @@
+/*=================================================================================================
+  About: Implementation of the seed file loading declared in seedfile.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "seedfile.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+#define SEED_FILE_MAGIC   "JFAS"
+#define SEED_FILE_VERSION 1
+
+/*=================================================================================================
+  STRUCTS
+=================================================================================================*/
+
+// The 16 bytes at the start of a binary seed file, which keep the seeds after it 8-byte aligned
+struct SeedFileHeader {
+	char magic[4];
+	unsigned int version;
+	unsigned long long numSeeds;
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+SeedFile::SeedFile( void ) :
+	Mapping( NULL ),
+	MappingSize( 0 ),
+	Data( NULL ),
+	Count( 0 ) {
+
+}
+
+SeedFile::~SeedFile( void ) {
+
+	Close();
+
+}
+
+void SeedFile::Close( void ) {
+
+	if( Mapping != NULL ) {
+		munmap( Mapping, MappingSize );
+		Mapping = NULL;
+		MappingSize = 0;
+	}
+
+	Parsed.clear();
+
+	Data  = NULL;
+	Count = 0;
+
+}
+
+bool SeedFile::Load( const char* filename ) {
+
+	Close();
+
+	int file = open( filename, O_RDONLY );
+	if( file == -1 )
+		return false;
+
+	// Binary files are told apart by their header
+	SeedFileHeader header;
+	struct stat info;
+
+	bool binary = fstat( file, &info ) == 0 &&
+	              read( file, &header, sizeof( header ) ) == (ssize_t)sizeof( header ) &&
+	              memcmp( header.magic, SEED_FILE_MAGIC, 4 ) == 0;
+
+	bool loaded = binary ? MapBinary( file, (size_t)info.st_size ) : ParseText( filename );
+	close( file );
+
+	if( loaded == false )
+		Close();
+
+	return loaded;
+
+}
+
+// Maps the whole file, and points Data at the seeds right after the header
+bool SeedFile::MapBinary( int file, size_t size ) {
+
+	const SeedFileHeader* header = NULL;
+
+	Mapping = mmap( NULL, size, PROT_READ, MAP_PRIVATE, file, 0 );
+	if( Mapping == MAP_FAILED ) {
+		Mapping = NULL;
+		return false;
+	}
+
+	MappingSize = size;
+	header = (const SeedFileHeader*)Mapping;
+
+	if( header->version != SEED_FILE_VERSION || header->numSeeds > INT_MAX ||
+	    size != sizeof( SeedFileHeader ) + sizeof( Point ) * header->numSeeds )
+		return false;
+
+	// The flooder reads the seeds from start to end as soon as it gets them
+	madvise( Mapping, size, MADV_WILLNEED );
+
+	Data  = (const Point*)( header + 1 );
+	Count = (int)header->numSeeds;
+
+	return true;
+
+}
+
+// Reads an integer at text, moving text past it. Returns false if there is none.
+static bool ParseInt( const char*& text, int& value ) {
+
+	char* end;
+	errno = 0;
+	long n = strtol( text, &end, 10 );
+
+	if( end == text || errno != 0 || n < INT_MIN || n > INT_MAX )
+		return false;
+
+	text  = end;
+	value = (int)n;
+	return true;
+
+}
+
+bool SeedFile::ParseText( const char* filename ) {
+
+	FILE* file = fopen( filename, "r" );
+	if( file == NULL )
+		return false;
+
+	char* line = NULL;
+	size_t lineSize = 0;
+
+	while( getline( &line, &lineSize, file ) != -1 ) {
+
+		const char* text = line;
+		Point p;
+
+		if( ParseInt( text, p.x ) == false )
+			continue;
+
+		while( *text == ',' || *text == ';' || *text == ' ' || *text == '\t' )
+			++text;
+
+		if( ParseInt( text, p.y ) == false )
+			continue;
+
+		if( Parsed.size() == INT_MAX )
+			break;
+
+		Parsed.push_back( p );
+
+	}
+
+	bool valid = ferror( file ) == 0 && Parsed.size() < INT_MAX;
+
+	free( line );
+	fclose( file );
+
+	if( valid == false )
+		return false;
+
+	Data  = Parsed.empty() ? NULL : &Parsed[0];
+	Count = (int)Parsed.size();
+
+	return true;
+
+}
+
+bool WriteSeedFile( const char* filename, const Point* seeds, int numSeeds ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	SeedFileHeader header;
+	memcpy( header.magic, SEED_FILE_MAGIC, 4 );
+	header.version  = SEED_FILE_VERSION;
+	header.numSeeds = numSeeds > 0 ? numSeeds : 0;
+
+	bool valid = fwrite( &header, sizeof( header ), 1, file ) == 1 &&
+	             fwrite( seeds, sizeof( Point ), header.numSeeds, file ) == header.numSeeds;
+
+	return fclose( file ) == 0 && valid;
+
+}
@@ -0,0 +1,80 @@
+/*=================================================================================================
+  About: Seed input for the Jump Flooding core. Seeds can come from a compact binary file, which
+   is memory-mapped and handed to the flooder without copying, or from a text file with one seed
+   per line, such as a CSV export.
+
+   The binary format is a 16-byte header followed by the seeds, all in the machine's byte order
+   (little-endian on x86):
+     bytes 0-3   "JFAS"
+     bytes 4-7   version, currently 1, as a 32-bit unsigned int
+     bytes 8-15  number of seeds, as a 64-bit unsigned int
+     then        each seed's x and y, as 32-bit signed ints
+
+   In text files, each line holding two integers separated by commas, semicolons or whitespace is
+   a seed. Other lines, such as headers and comments starting with '#', are skipped.
+=================================================================================================*/
+
+#ifndef _SEEDFILE_H_
+#define _SEEDFILE_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "point.h"
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+class SeedFile {
+
+public:
+
+	SeedFile( void );
+	~SeedFile( void );
+
+	// Loads the seeds of a binary or text file, telling them apart by the binary header. The
+	// seeds of the previous file are released first. Returns false if the file can't be read,
+	// is malformed, or holds more seeds than an int can count.
+	bool Load( const char* filename );
+
+	// Releases the seeds
+	void Close( void );
+
+	// The seeds, which remain valid until the next call to Load() or Close()
+	const Point* Seeds( void ) const { return Data; }
+	int NumSeeds( void ) const { return Count; }
+
+	// Was the last file binary, and so mapped rather than parsed?
+	bool IsMapped( void ) const { return Mapping != NULL; }
+
+private:
+
+	bool MapBinary( int file, size_t size );
+	bool ParseText( const char* filename );
+
+	// Not copyable, since we own the mapping
+	SeedFile( const SeedFile& );
+	SeedFile& operator=( const SeedFile& );
+
+	// The mapped binary file, if any
+	void* Mapping;
+	size_t MappingSize;
+
+	// Seeds parsed from a text file
+	std::vector<Point> Parsed;
+
+	// Where the seeds are, in the mapping or in Parsed
+	const Point* Data;
+	int Count;
+
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Writes seeds in the binary format. Returns false if the file couldn't be written.
+bool WriteSeedFile( const char* filename, const Point* seeds, int numSeeds );
+
+#endif
@@ -0,0 +1,127 @@
+/*=================================================================================================
+  About: Implementation of the ThreadPool class declared in threadpool.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include "threadpool.h"
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+ThreadPool::ThreadPool( int numThreads ) :
+	CurTask( NULL ),
+	CurArg( NULL ),
+	TaskGeneration( 0 ),
+	NumBusy( 0 ),
+	BarrierCount( 0 ),
+	BarrierGeneration( 0 ),
+	Quit( false ) {
+
+	if( numThreads < 1 )
+		numThreads = std::thread::hardware_concurrency();
+
+	// The calling thread is thread 0, so we only need to create the others
+	for( int i = 1; i < numThreads; ++i )
+		Workers.push_back( std::thread( &ThreadPool::WorkerLoop, this, i ) );
+
+}
+
+ThreadPool::~ThreadPool( void ) {
+
+	{
+		std::lock_guard<std::mutex> lock( Mutex );
+		Quit = true;
+	}
+	WakeCond.notify_all();
+
+	for( size_t i = 0; i < Workers.size(); ++i )
+		Workers[i].join();
+
+}
+
+// Workers sleep until a new task is posted, run it and report back
+void ThreadPool::WorkerLoop( int threadIdx ) {
+
+	unsigned int seenGeneration = 0;
+
+	while( true ) {
+
+		Task task;
+		void* arg;
+
+		{
+			std::unique_lock<std::mutex> lock( Mutex );
+			while( Quit == false && TaskGeneration == seenGeneration )
+				WakeCond.wait( lock );
+
+			if( Quit == true )
+				return;
+
+			seenGeneration = TaskGeneration;
+			task = CurTask;
+			arg  = CurArg;
+		}
+
+		task( arg, threadIdx, NumThreads() );
+
+		{
+			std::lock_guard<std::mutex> lock( Mutex );
+			if( --NumBusy == 0 )
+				DoneCond.notify_one();
+		}
+
+	}
+
+}
+
+void ThreadPool::Run( Task task, void* arg ) {
+
+	// Nothing to hand out, so just run it here
+	if( Workers.empty() ) {
+		task( arg, 0, 1 );
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( Mutex );
+		CurTask = task;
+		CurArg  = arg;
+		NumBusy = (int)Workers.size();
+		++TaskGeneration;
+	}
+	WakeCond.notify_all();
+
+	// The calling thread does its share of the work too
+	task( arg, 0, NumThreads() );
+
+	std::unique_lock<std::mutex> lock( Mutex );
+	while( NumBusy > 0 )
+		DoneCond.wait( lock );
+
+}
+
+void ThreadPool::Barrier( void ) {
+
+	if( Workers.empty() )
+		return;
+
+	std::unique_lock<std::mutex> lock( Mutex );
+
+	unsigned int generation = BarrierGeneration;
+
+	// The last thread to arrive releases everyone else
+	if( ++BarrierCount == NumThreads() ) {
+		BarrierCount = 0;
+		++BarrierGeneration;
+		BarrierCond.notify_all();
+		return;
+	}
+
+	while( generation == BarrierGeneration )
+		BarrierCond.wait( lock );
+
+}
@@ -0,0 +1,66 @@
+/*=================================================================================================
+  About: A small persistent pool of worker threads. A task is run on every thread of the pool at
+   once (the calling thread takes part as thread 0), and the threads can synchronize with each
+   other through Barrier() while the task is running. The workers sleep between tasks, so the
+   pool can be kept around and reused for every execution of the algorithm.
+=================================================================================================*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+
+public:
+
+	// A task receives its argument, the index of the thread running it and the number of threads
+	typedef void (*Task)( void* arg, int threadIdx, int numThreads );
+
+	// Creates a pool with numThreads threads in total, including the caller. If numThreads is
+	// less than 1, one thread per hardware thread is used.
+	ThreadPool( int numThreads );
+	~ThreadPool( void );
+
+	int NumThreads( void ) const { return (int)Workers.size() + 1; }
+
+	// Runs the task on every thread and returns when all of them are finished
+	void Run( Task task, void* arg );
+
+	// Called from inside a task. Waits until every thread of the pool has reached the barrier.
+	void Barrier( void );
+
+private:
+
+	// Not copyable, since we own the threads
+	ThreadPool( const ThreadPool& );
+	ThreadPool& operator=( const ThreadPool& );
+
+	void WorkerLoop( int threadIdx );
+
+	std::vector<std::thread> Workers;
+
+	std::mutex Mutex;
+	std::condition_variable WakeCond;
+	std::condition_variable DoneCond;
+	std::condition_variable BarrierCond;
+
+	// The task being run and how many workers have yet to finish it
+	Task CurTask;
+	void* CurArg;
+	unsigned int TaskGeneration;
+	int NumBusy;
+
+	// Barrier state
+	int BarrierCount;
+	unsigned int BarrierGeneration;
+
+	// Set when the pool is being destroyed
+	bool Quit;
+
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*=================================================================================================
+  About: Implementation of the checks declared in verify.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <math.h>
+#include <stdio.h>
+
+#include "jumpflood.h"
+#include "threadpool.h"
+#include "verify.h"
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+SeedGrid::SeedGrid( const Point* seeds, int numSeeds, int width, int height ) {
+
+	// Only the seeds inside the grid take part in the flooding
+	std::vector<Point> inside;
+	for( int i = 0; i < numSeeds; ++i )
+		if( seeds[i].x >= 0 && seeds[i].x < width && seeds[i].y >= 0 && seeds[i].y < height )
+			inside.push_back( seeds[i] );
+
+	// Cells of about two seeds each
+	double area = (double)width * height / ( inside.empty() ? 1 : inside.size() );
+	CellSize = (int)sqrt( 2 * area );
+	if( CellSize < 1 )
+		CellSize = 1;
+
+	GridWidth  = ( width  + CellSize - 1 ) / CellSize;
+	GridHeight = ( height + CellSize - 1 ) / CellSize;
+
+	// Count the seeds of each cell, then sort them into place
+	CellStart.assign( (size_t)GridWidth * GridHeight + 1, 0 );
+	for( size_t i = 0; i < inside.size(); ++i )
+		++CellStart[ ( inside[i].y / CellSize ) * GridWidth + inside[i].x / CellSize + 1 ];
+
+	for( size_t i = 1; i < CellStart.size(); ++i )
+		CellStart[i] += CellStart[ i - 1 ];
+
+	std::vector<int> next( CellStart.begin(), CellStart.end() - 1 );
+	CellSeeds.resize( inside.size() );
+	for( size_t i = 0; i < inside.size(); ++i )
+		CellSeeds[ next[ ( inside[i].y / CellSize ) * GridWidth + inside[i].x / CellSize ]++ ] = inside[i];
+
+}
+
+// Searches rings of cells of growing radius around the pixel's cell. Every pixel of a cell r
+// rings away is at least (r-1)*CellSize+1 pixels away, so we can stop once the closest seed
+// found so far is at most that far.
+long long SeedGrid::ClosestDistance( int x, int y ) const {
+
+	if( CellSeeds.empty() )
+		return -1;
+
+	int cx = x / CellSize;
+	int cy = y / CellSize;
+
+	long long closest = -1;
+
+	for( int r = 0; ; ++r ) {
+
+		if( r > 0 && closest != -1 ) {
+			long long gap = (long long)( r - 1 ) * CellSize + 1;
+			if( closest <= gap * gap )
+				break;
+		}
+
+		// Past every edge of the grid there's nothing left to search
+		if( cx - r < 0 && cy - r < 0 && cx + r >= GridWidth && cy + r >= GridHeight )
+			break;
+
+		for( int gy = cy - r; gy <= cy + r; ++gy ) {
+
+			if( gy < 0 || gy >= GridHeight )
+				continue;
+
+			// Inside the ring, only its first and last cells belong to it
+			int gxStep = ( gy == cy - r || gy == cy + r || r == 0 ) ? 1 : 2 * r;
+
+			for( int gx = cx - r; gx <= cx + r; gx += gxStep ) {
+
+				if( gx < 0 || gx >= GridWidth )
+					continue;
+
+				int cell = gy * GridWidth + gx;
+				for( int i = CellStart[ cell ]; i < CellStart[ cell + 1 ]; ++i ) {
+					long long dx = CellSeeds[i].x - x;
+					long long dy = CellSeeds[i].y - y;
+					long long dist = dx*dx + dy*dy;
+					if( closest == -1 || dist < closest )
+						closest = dist;
+				}
+
+			}
+
+		}
+
+	}
+
+	return closest;
+
+}
+
+bool SeedGrid::HasSeedAt( int x, int y ) const {
+
+	if( CellSeeds.empty() || x < 0 || x >= GridWidth * CellSize || y < 0 || y >= GridHeight * CellSize )
+		return false;
+
+	int cell = ( y / CellSize ) * GridWidth + x / CellSize;
+	for( int i = CellStart[ cell ]; i < CellStart[ cell + 1 ]; ++i )
+		if( CellSeeds[i].x == x && CellSeeds[i].y == y )
+			return true;
+
+	return false;
+
+}
+
+// What each thread works on, and its share of the statistics
+template< class Flooder >
+struct VerifyTask {
+	const Flooder* flooder;
+	const SeedGrid* grid;
+	float* errors;
+	std::vector<VerifyStats> partial;
+	std::vector<double> errorSum;
+};
+
+template< class Flooder >
+static void VerifyBand( void* arg, int threadIdx, int numThreads ) {
+
+	VerifyTask<Flooder>* task = (VerifyTask<Flooder>*)arg;
+	const Flooder& flooder = *task->flooder;
+
+	int width  = flooder.Width();
+	int height = flooder.Height();
+
+	int yBegin = (int)( (long long)height * threadIdx / numThreads );
+	int yEnd   = (int)( (long long)height * ( threadIdx + 1 ) / numThreads );
+
+	VerifyStats& stats = task->partial[ threadIdx ];
+	double& errorSum = task->errorSum[ threadIdx ];
+
+	for( int y = yBegin; y < yEnd; ++y ) {
+		for( int x = 0; x < width; ++x ) {
+
+			float error = 0;
+
+			long long closest = task->grid->ClosestDistance( x, y );
+			Point p = flooder.NearestSeed( x, y );
+
+			if( p.x == -1 || p.y == -1 ) {
+				if( closest != -1 ) {
+					++stats.numEmpty;
+					error = -1;
+				}
+			}
+			else if( task->grid->HasSeedAt( p.x, p.y ) == false ) {
+				// A position left over from a seed that moved or never existed, which may well
+				// be closer than any real seed
+				++stats.numInvalid;
+				error = -1;
+			}
+			else {
+				long long dx = p.x - x;
+				long long dy = p.y - y;
+				long long dist = dx*dx + dy*dy;
+
+				if( dist > closest ) {
+					error = (float)( sqrt( (double)dist ) - sqrt( (double)closest ) );
+					++stats.numMisclassified;
+					errorSum += error;
+					if( error > stats.maxError )
+						stats.maxError = error;
+				}
+			}
+
+			++stats.numPixels;
+
+			if( task->errors != NULL )
+				task->errors[ (size_t)y * width + x ] = error;
+
+		}
+	}
+
+}
+
+template< class Flooder >
+bool VerifyNearestSeeds( const Flooder& flooder, const Point* seeds, int numSeeds, int numThreads,
+                         VerifyStats& stats, unsigned char* heatmap ) {
+
+	if( flooder.Result() == NULL )
+		return false;
+
+	int width  = flooder.Width();
+	int height = flooder.Height();
+
+	SeedGrid grid( seeds, numSeeds, width, height );
+
+	// The heatmap is scaled by the largest error, which we only know at the end
+	std::vector<float> errors;
+	if( heatmap != NULL )
+		errors.resize( (size_t)width * height );
+
+	ThreadPool pool( numThreads );
+
+	VerifyStats zero = { 0, 0, 0, 0, 0, 0 };
+
+	VerifyTask<Flooder> task;
+	task.flooder  = &flooder;
+	task.grid     = &grid;
+	task.errors   = heatmap != NULL ? &errors[0] : NULL;
+	task.partial.assign( pool.NumThreads(), zero );
+	task.errorSum.assign( pool.NumThreads(), 0 );
+
+	pool.Run( &VerifyBand<Flooder>, &task );
+
+	// Add up the threads' statistics
+	stats = zero;
+	double errorSum = 0;
+
+	for( int t = 0; t < pool.NumThreads(); ++t ) {
+		const VerifyStats& s = task.partial[t];
+		stats.numPixels        += s.numPixels;
+		stats.numMisclassified += s.numMisclassified;
+		stats.numEmpty         += s.numEmpty;
+		stats.numInvalid       += s.numInvalid;
+		stats.maxError          = s.maxError > stats.maxError ? s.maxError : stats.maxError;
+		errorSum               += task.errorSum[t];
+	}
+
+	if( stats.numMisclassified > 0 )
+		stats.meanError = errorSum / stats.numMisclassified;
+
+	// Empty pixels and those without a real seed are as wrong as it gets
+	if( heatmap != NULL ) {
+		for( size_t i = 0; i < errors.size(); ++i ) {
+			if( errors[i] == 0 )
+				heatmap[i] = 0;
+			else if( errors[i] < 0 || stats.maxError <= 0 )
+				heatmap[i] = 255;
+			else
+				heatmap[i] = (unsigned char)( 1 + 254 * errors[i] / stats.maxError );
+		}
+	}
+
+	return true;
+
+}
+
+bool WriteHeatmap( const char* filename, const unsigned char* heatmap, int width, int height ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	fprintf( file, "P5\n%i %i\n255\n", width, height );
+	size_t written = fwrite( heatmap, 1, (size_t)width * height, file );
+
+	return fclose( file ) == 0 && written == (size_t)width * height;
+
+}
+
+// The flooders we support
+template bool VerifyNearestSeeds( const JumpFlooder&, const Point*, int, int, VerifyStats&, unsigned char* );
+template bool VerifyNearestSeeds( const IndexJumpFlooder&, const Point*, int, int, VerifyStats&, unsigned char* );
+template bool VerifyNearestSeeds( const SmallIndexJumpFlooder&, const Point*, int, int, VerifyStats&, unsigned char* );
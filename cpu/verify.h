@@ -0,0 +1,75 @@
+/*=================================================================================================
+  About: Ground truth for the Jump Flooding results. The exact closest seed of every pixel is
+   found with a uniform grid over the seeds, so the check stays usable with hundreds of thousands
+   of seeds, and compared with the nearest-seed map of a flooder. The pixels are split into bands
+   of rows over a thread pool, like the flooding itself.
+=================================================================================================*/
+
+#ifndef _VERIFY_H_
+#define _VERIFY_H_
+
+#include <vector>
+
+#include "point.h"
+
+/*=================================================================================================
+  STRUCTS
+=================================================================================================*/
+
+// How a nearest-seed map compares with the exact one
+struct VerifyStats {
+	long long numPixels;
+	long long numMisclassified; // Pixels whose seed is farther away than their closest seed
+	long long numEmpty;         // Pixels left without a seed
+	long long numInvalid;       // Pixels whose seed isn't at the position of any of the seeds
+	double maxError;            // Largest distance error of a misclassified pixel, in pixels
+	double meanError;           // Average distance error of the misclassified pixels
+};
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+// The seeds inside a width x height grid, bucketed into square cells of about two seeds each
+class SeedGrid {
+
+public:
+
+	SeedGrid( const Point* seeds, int numSeeds, int width, int height );
+
+	// Squared distance from (x,y) to its closest seed, or -1 if there are no seeds
+	long long ClosestDistance( int x, int y ) const;
+
+	// Is there a seed at (x,y)?
+	bool HasSeedAt( int x, int y ) const;
+
+private:
+
+	// Size of the square cells, in pixels, and the number of cells in each direction
+	int CellSize;
+	int GridWidth;
+	int GridHeight;
+
+	// The seeds of cell i are CellSeeds[ CellStart[i] ] to CellSeeds[ CellStart[i+1] - 1 ]
+	std::vector<int> CellStart;
+	std::vector<Point> CellSeeds;
+
+};
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Compares the last nearest-seed map of a flooder with the exact closest seeds of the seeds it
+// was given, on numThreads threads (less than 1 uses one per hardware thread). Ties count as
+// correct, but only if the map points at one of the seeds. If heatmap isn't NULL, it receives a
+// byte per pixel: 0 where the map is right, and from 1 to 255 as the distance error grows up to
+// its maximum. Returns false if there is no map.
+template< class Flooder >
+bool VerifyNearestSeeds( const Flooder& flooder, const Point* seeds, int numSeeds, int numThreads,
+                         VerifyStats& stats, unsigned char* heatmap );
+
+// Writes a heatmap as a binary PGM image. Returns false if the file couldn't be written.
+bool WriteHeatmap( const char* filename, const unsigned char* heatmap, int width, int height );
+
+#endif
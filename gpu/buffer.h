@@ -4,7 +4,6 @@
 #include <iostream>
 
 #include <GL/glew.h>
-#include <GL/glut.h>
 
 bool checkFramebufferStatus();
 std::string convertInternalFormatToString(GLenum format);
@@ -0,0 +1,421 @@
+/*=================================================================================================
+  About: A headless runner for the GPU implementation in render.h. Instead of opening a window
+   with GLUT, it creates an OpenGL context without any surface through EGL (on Mesa, this works
+   without a display or a GPU, with llvmpipe), floods a fixed number of frames of moving seeds
+   and saves the result.
+
+   The result is read back through pixel buffer objects, one per frame in flight, so reading a
+   frame doesn't stall the pipeline: it's copied into the frame's buffer on the GPU, and only
+   mapped and saved when the CPU waits for that frame's slot anyway, two frames later. Outputs
+   ending in .ppm get the colored diagram, as the window would show it, and any other output gets
+   the raw label map of cpu/labelmap.h, with the index of each pixel's closest seed as a 32-bit
+   value, row by row from y = 0. If the output's name has a printf-style integer in it, such as
+   frame%04d.ppm, every frame is saved, and otherwise only the last one.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "render.h"
+#include "rfUtil.h"
+#include "seedfile.h"
+
+using namespace std;
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+#define DEFAULT_WIDTH     1024
+#define DEFAULT_HEIGHT     768
+#define DEFAULT_NUM_SEEDS   16
+#define DEFAULT_FRAMES     100
+
+// Time step of each frame, as if running at 60 frames per second
+#define DEFAULT_FRAME_TIME ( 1000.0 / 60.0 )
+
+// Range of the random seeds' speed, in pixels per second at the default dimensions, like main.cpp
+#define MAX_SEED_SPEED 200
+
+/*=================================================================================================
+  STRUCTS
+=================================================================================================*/
+
+// Command line options
+struct Options {
+	int width;
+	int height;
+	int numSeeds;
+	int randSeed;
+	int numFrames;
+	double frameTime;
+	StepSchedule schedule;
+	FloodBackend backend;
+	const char* seedFile;
+	const char* outputFile;
+};
+
+/*=================================================================================================
+  GLOBALS
+=================================================================================================*/
+
+// Offscreen framebuffer the colored diagram is drawn to, for .ppm outputs
+GLuint TargetFBO = 0, TargetTexture = 0;
+
+// Pixel buffer of each slot, and the frame whose result it holds (-1 if none)
+GLuint PixelBuffers[ FRAMES_IN_FLIGHT ];
+int PendingFrames[ FRAMES_IN_FLIGHT ];
+
+// Are we saving the colored diagram rather than the labels?
+bool SaveColors = false;
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+void PrintUsage( const char* name ) {
+
+	printf( "Usage: %s [-w width] [-h height] [-n seeds] [-r random seed] [-f seeds.bin|.csv (instead of random seeds)]\n"
+	        "          [-i frames] [-d milliseconds per frame] [-s jfa|jfa+1|jfa+2|1+jfa|jfa^2] [-b fragment|compute]\n"
+	        "          [-o output.ppm|labels.raw (may hold a frame number, as in frame%%04d.ppm)]\n", name );
+
+}
+
+// Creates an OpenGL core profile context of the given version with no surface, and makes it
+// current. Returns false if there's no way to get one.
+bool CreateContext( int major, int minor ) {
+
+	// The surfaceless platform needs no display server. Without it, try the default display.
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if( getPlatformDisplay != NULL )
+		display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+	if( display == EGL_NO_DISPLAY )
+		display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint eglMajor, eglMinor;
+	if( display == EGL_NO_DISPLAY || eglInitialize( display, &eglMajor, &eglMinor ) == EGL_FALSE ) {
+		printf( "Couldn't initialize EGL.\n" );
+		return false;
+	}
+
+	if( eglBindAPI( EGL_OPENGL_API ) == EGL_FALSE ) {
+		printf( "EGL doesn't support OpenGL.\n" );
+		return false;
+	}
+
+	// We draw to framebuffer objects only, so the context needs no config
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	EGLContext context = eglCreateContext( display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes );
+	if( context == EGL_NO_CONTEXT || eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) == EGL_FALSE ) {
+		printf( "Couldn't create an OpenGL %i.%i core profile context.\n", major, minor );
+		return false;
+	}
+
+	printf( "OpenGL %s, %s\n", glGetString( GL_VERSION ), glGetString( GL_RENDERER ) );
+
+	return true;
+
+}
+
+// Create the offscreen framebuffer and the pixel buffers for reading the results back
+void CreateReadback( int width, int height ) {
+
+	if( SaveColors == true ) {
+
+		glGenTextures( 1, &TargetTexture );
+		glBindTexture( GL_TEXTURE_2D, TargetTexture );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+
+		glGenFramebuffers( 1, &TargetFBO );
+		glBindFramebuffer( GL_FRAMEBUFFER, TargetFBO );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, TargetTexture, 0 );
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	}
+
+	// Both a color and a label take 4 bytes per pixel
+	glGenBuffers( FRAMES_IN_FLIGHT, PixelBuffers );
+	for( int i = 0; i < FRAMES_IN_FLIGHT; ++i ) {
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[i] );
+		glBufferData( GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ );
+		PendingFrames[i] = -1;
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+}
+
+// Start copying the frame's result into its slot's pixel buffer, to be saved once it's finished
+void ReadFrame( int slot, int frame ) {
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[ slot ] );
+
+	if( SaveColors == true ) {
+		glBindFramebuffer( GL_READ_FRAMEBUFFER, TargetFBO );
+		glReadBuffer( GL_COLOR_ATTACHMENT0 );
+		glReadPixels( 0, 0, BufferWidth, BufferHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0 );
+		glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	}
+	else {
+		glBindTexture( GL_TEXTURE_RECTANGLE, ResultTexture() );
+		glGetTexImage( GL_TEXTURE_RECTANGLE, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0 );
+		glBindTexture( GL_TEXTURE_RECTANGLE, 0 );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	PendingFrames[ slot ] = frame;
+
+}
+
+bool WritePPM( const char* filename, const unsigned char* pixels, int width, int height ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	bool valid = fprintf( file, "P6\n%i %i\n255\n", width, height ) > 0;
+
+	// OpenGL's rows go from the bottom up, images' from the top down
+	vector<unsigned char> row( (size_t)width * 3 );
+	for( int y = height - 1; y >= 0 && valid; --y ) {
+		const unsigned char* source = pixels + (size_t)y * width * 4;
+		for( int x = 0; x < width; ++x ) {
+			row[ 3 * x ]     = source[ 4 * x ];
+			row[ 3 * x + 1 ] = source[ 4 * x + 1 ];
+			row[ 3 * x + 2 ] = source[ 4 * x + 2 ];
+		}
+		valid = fwrite( &row[0], row.size(), 1, file ) == 1;
+	}
+
+	return fclose( file ) == 0 && valid;
+
+}
+
+bool WriteRawLabels( const char* filename, const unsigned int* labels, int width, int height ) {
+
+	FILE* file = fopen( filename, "wb" );
+	if( file == NULL )
+		return false;
+
+	size_t numPixels = (size_t)width * height;
+	bool valid = fwrite( labels, sizeof( unsigned int ), numPixels, file ) == numPixels;
+
+	return fclose( file ) == 0 && valid;
+
+}
+
+// Save the result waiting in a slot's pixel buffer, whose frame must be finished. Returns false
+// if it couldn't be written.
+bool SaveFrame( int slot, const char* output ) {
+
+	int frame = PendingFrames[ slot ];
+	if( frame == -1 )
+		return true;
+
+	PendingFrames[ slot ] = -1;
+
+	char filename[1024];
+	snprintf( filename, sizeof( filename ), output, frame );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[ slot ] );
+	const void* pixels = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)BufferWidth * BufferHeight * 4, GL_MAP_READ_BIT );
+
+	bool valid = false;
+	if( pixels != NULL ) {
+		if( SaveColors == true )
+			valid = WritePPM( filename, (const unsigned char*)pixels, BufferWidth, BufferHeight );
+		else
+			valid = WriteRawLabels( filename, (const unsigned int*)pixels, BufferWidth, BufferHeight );
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	if( valid == false )
+		printf( "Couldn't write %s.\n", filename );
+
+	return valid;
+
+}
+
+// Place the seeds of a file, which are in pixels, or random ones with random velocities
+bool CreateSeeds( const Options& opts ) {
+
+	SeedFile seedFile;
+	if( opts.seedFile != NULL && ( seedFile.Load( opts.seedFile ) == false || seedFile.NumSeeds() < 1 ) ) {
+		printf( "Couldn't read any seeds from %s.\n", opts.seedFile );
+		return false;
+	}
+
+	int numSeeds = opts.seedFile != NULL ? seedFile.NumSeeds() : opts.numSeeds;
+
+	Seeds.Clear();
+	Seeds.Reserve( numSeeds );
+
+	for( int i = 0; i < numSeeds; ++i ) {
+
+		float x, y, vx, vy;
+
+		// Seeds from a file stay put, in the middle of their pixel
+		if( opts.seedFile != NULL ) {
+			x = ( seedFile.Seeds()[i].x + 0.5f ) / opts.width;
+			y = ( seedFile.Seeds()[i].y + 0.5f ) / opts.height;
+			vx = vy = 0;
+		}
+		else {
+			x = rand() / ( RAND_MAX + 1.0f );
+			y = rand() / ( RAND_MAX + 1.0f );
+			vx = ( rand() / ( RAND_MAX + 1.0f ) * 2 - 1 ) * MAX_SEED_SPEED / DEFAULT_WIDTH;
+			vy = ( rand() / ( RAND_MAX + 1.0f ) * 2 - 1 ) * MAX_SEED_SPEED / DEFAULT_HEIGHT;
+		}
+
+		float r = rand() / ( RAND_MAX + 1.0f );
+		float g = rand() / ( RAND_MAX + 1.0f );
+		float b = rand() / ( RAND_MAX + 1.0f );
+
+		Seeds.Add( x, y, r, g, b, vx, vy );
+
+	}
+
+	return true;
+
+}
+
+int main( int argc, char **argv ) {
+
+	Options opts;
+	opts.width      = DEFAULT_WIDTH;
+	opts.height     = DEFAULT_HEIGHT;
+	opts.numSeeds   = DEFAULT_NUM_SEEDS;
+	opts.randSeed   = 1;
+	opts.numFrames  = DEFAULT_FRAMES;
+	opts.frameTime  = DEFAULT_FRAME_TIME;
+	opts.schedule   = SCHEDULE_JFA;
+	opts.backend    = FRAGMENT_BACKEND;
+	opts.seedFile   = NULL;
+	opts.outputFile = NULL;
+
+	// Read options from the command line
+	int opt;
+	while( ( opt = getopt( argc, argv, "w:h:n:r:f:i:d:s:b:o:" ) ) != -1 ) {
+		switch( opt ) {
+			case 'w': opts.width      = atoi( optarg ); break;
+			case 'h': opts.height     = atoi( optarg ); break;
+			case 'n': opts.numSeeds   = atoi( optarg ); break;
+			case 'r': opts.randSeed   = atoi( optarg ); break;
+			case 'f': opts.seedFile   = optarg; break;
+			case 'i': opts.numFrames  = atoi( optarg ); break;
+			case 'd': opts.frameTime  = atof( optarg ); break;
+			case 's': opts.schedule   = FindStepSchedule( optarg ); break;
+			case 'b':
+				if( strcmp( optarg, "compute" ) == 0 )
+					opts.backend = COMPUTE_BACKEND;
+				else if( strcmp( optarg, "fragment" ) == 0 )
+					opts.backend = FRAGMENT_BACKEND;
+				else {
+					PrintUsage( argv[0] );
+					return 1;
+				}
+				break;
+			case 'o': opts.outputFile = optarg; break;
+			default:
+				PrintUsage( argv[0] );
+				return 1;
+		}
+	}
+
+	if( opts.width < 1 || opts.height < 1 || opts.numSeeds < 1 || opts.numFrames < 1 ||
+	    opts.schedule == NUM_SCHEDULES ) {
+		PrintUsage( argv[0] );
+		return 1;
+	}
+
+	// Compute shaders need a newer context
+	if( CreateContext( 3 + ( opts.backend == COMPUTE_BACKEND ), 3 ) == false )
+		return 1;
+
+	// Core profiles need GLEW to look up every entry point. GLEW builds made for GLX can't tell
+	// which version an EGL context has, but they load the entry points all the same.
+	glewExperimental = GL_TRUE;
+	if( glewInit() != GLEW_OK && glGenFramebuffers == NULL ) {
+		printf( "Couldn't initialize GLEW.\n" );
+		return 1;
+	}
+
+	srand( opts.randSeed );
+
+	if( CreateSeeds( opts ) == false )
+		return 1;
+
+	Schedule = opts.schedule;
+	Backend  = opts.backend;
+
+	InitializeRenderer( opts.width, opts.height );
+	UploadSeeds();
+
+	const char* extension = opts.outputFile != NULL ? strrchr( opts.outputFile, '.' ) : NULL;
+	SaveColors = extension != NULL && strcmp( extension, ".ppm" ) == 0;
+	bool saveAll = opts.outputFile != NULL && strchr( opts.outputFile, '%' ) != NULL;
+
+	CreateReadback( opts.width, opts.height );
+
+	printf( "%i seeds, %ix%i, %s backend, %s schedule\n", Seeds.NumSeeds(), opts.width, opts.height,
+	        opts.backend == COMPUTE_BACKEND ? "compute" : "fragment", StepScheduleName( opts.schedule ) );
+
+	bool valid = true;
+	double startTime = get_clock_msec();
+
+	for( int frame = 0; frame < opts.numFrames; ++frame ) {
+
+		// The slot's last frame is finished once BeginFrame() returns, so its result can be saved
+		int slot = BeginFrame( opts.frameTime );
+		if( opts.outputFile != NULL )
+			valid = SaveFrame( slot, opts.outputFile ) && valid;
+
+		FloodFrame( slot );
+		if( SaveColors == true )
+			DisplayFrame( TargetFBO, false );
+
+		if( opts.outputFile != NULL && ( saveAll == true || frame == opts.numFrames - 1 ) )
+			ReadFrame( slot, frame );
+
+		EndFrame( slot );
+
+	}
+
+	// Wait for the frames still in flight and save their results
+	for( int i = 0; i < FRAMES_IN_FLIGHT; ++i ) {
+		int slot = ( FrameIndex + i ) % FRAMES_IN_FLIGHT;
+		WaitForFrame( slot );
+		if( opts.outputFile != NULL )
+			valid = SaveFrame( slot, opts.outputFile ) && valid;
+	}
+
+	double totalTime = get_clock_msec() - startTime;
+
+	printf( "%i frames, %i passes each: %.3f ms per frame\n", opts.numFrames, NumPasses, totalTime / opts.numFrames );
+	PrintPassTimes();
+
+	return valid ? 0 : 1;
+
+}
@@ -0,0 +1,915 @@
+/*=================================================================================================
+  About: The GPU Jump Flooding pipeline declared in render.h, which needs an OpenGL context but
+   no window. It's shared by the interactive program in main.cpp and the headless runner in
+   headless.cpp.
+
+   Rendering uses an OpenGL 3.3 core profile context. The seed positions live in a vertex buffer
+   that stays mapped (when ARB_buffer_storage is available) and is rewritten in place every frame,
+   and each pass draws one full-screen triangle, so the GL calls per frame don't grow with the
+   number of seeds.
+
+   The flooding buffers match the size of the output, such as the window, and are reallocated when
+   it changes. The only thing flooded is the index of each pixel's closest seed, 4 bytes per pixel
+   in a single attachment. The passes look the seeds' positions up in the vertex buffer, read as a
+   buffer texture, and the display pass turns the index into the seed's color.
+
+   The passes can run on one of two backends, picked at startup:
+     fragment  each pass draws a full-screen triangle with jump.frag (the default)
+     compute   the passes with large steps are dispatched one by one with jump.comp, and the
+               trailing passes with small steps all run in a single dispatch of tile.comp, which
+               keeps a tile and its surroundings in shared memory between them. This needs
+               OpenGL 4.3.
+   Both give the same result.
+
+   Frames are pipelined rather than finished one at a time: each frame ends with a fence, and the
+   seed positions of the next frame are computed and written into the other half of the vertex
+   buffer while the GPU is still flooding. The CPU only waits for the frame before last, whose half
+   of the buffer it's about to reuse. Timestamps taken between the passes of that frame are read
+   back at the same point, and PrintPassTimes() prints their averages. The seeds are kept by a
+   SeedStore, which moves them and writes their positions in one vectorized sweep, so a million of
+   them don't hold up a frame.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "shader.h"
+#include "buffer.h"
+#include "render.h"
+
+using namespace std;
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Timestamps of a frame: before the seeds are drawn, after them and each pass, and after the
+// display pass
+#define MAX_FRAME_TIMESTAMPS ( MAX_SCHEDULE_PASSES + 3 )
+
+// Shared memory tiles of the compute backend, which must match shaders/tile.comp: the tile size,
+// the most the steps of the tiled passes may add up to, and the most tiled passes
+#define TILE_SIZE       32
+#define MAX_APRON       16
+#define MAX_TILE_PASSES 16
+
+// Work group size of shaders/jump.comp
+#define JUMP_GROUP_SIZE 16
+
+/*=================================================================================================
+  GLOBALS
+=================================================================================================*/
+
+// How large to draw each seed's marker, used with glPointSize()
+int SeedSize = 10;
+
+// The seeds
+SeedStore Seeds;
+
+// Dimensions of the flooding buffers
+int BufferWidth  = 0;
+int BufferHeight = 0;
+
+StepSchedule Schedule = SCHEDULE_JFA;
+int NumPasses = 0;
+
+FloodBackend Backend = FRAGMENT_BACKEND;
+
+// Shaders
+#define numShaders 3
+enum ShaderEnum {
+	CPOS_SHADER = 0,
+	TEXTURE_SHADER,
+	MARKER_SHADER
+};
+GLuint progID[ numShaders ];
+
+// Variants of the jump flooding shader: one for the strips along the edges, whose neighbors may
+// be outside the buffers, and for the inner rectangle, where they can't, a general one and one
+// for each of the smallest steps (1, 2, 4 and 8), which make the neighbors' offsets constants
+#define numConstStepVariants 4
+#define numJumpVariants ( 2 + numConstStepVariants )
+enum JumpVariantEnum {
+	JUMP_BORDER_VARIANT = 0,
+	JUMP_INTERIOR_VARIANT,
+	JUMP_STEP_1_VARIANT
+};
+GLuint jumpProgID[ numJumpVariants ];
+
+// Compute shaders, only created for the compute backend
+#define numComputeShaders 2
+enum ComputeShaderEnum {
+	JUMP_COMPUTE_SHADER = 0,
+	TILE_COMPUTE_SHADER
+};
+GLuint compProgID[ numComputeShaders ];
+
+// Uniform locations, looked up once when the programs are created
+GLint uJumpTex0Loc[ numJumpVariants ], uJumpSeedsLoc[ numJumpVariants ], uJumpSeedOffsetLoc[ numJumpVariants ];
+GLint uJumpWidthLoc[ numJumpVariants ], uJumpHeightLoc[ numJumpVariants ], uJumpStepLoc[ numJumpVariants ];
+GLint uTextureTexLoc, uTextureColorsLoc;
+GLint uMarkerColorLoc;
+
+// Uniform locations of the compute shaders, which share most of their uniforms
+GLint uCompSrcLoc[ numComputeShaders ], uCompDstLoc[ numComputeShaders ];
+GLint uCompSeedsLoc[ numComputeShaders ], uCompSeedOffsetLoc[ numComputeShaders ], uCompSizeLoc[ numComputeShaders ];
+GLint uCompStepLoc, uCompStepsLoc, uCompNumStepsLoc, uCompApronLoc;
+
+// Vertex attributes of the seeds. Each seed's index, which is what gets flooded, is its
+// gl_VertexID.
+enum AttribEnum {
+	POSITION_ATTRIB = 0
+};
+
+// Seed data: positions, rewritten every frame, and colors, written when the seeds are created.
+// Both are also read through buffer textures, the positions by the jump flooding passes and the
+// colors by the display pass. SeedVAO draws the seeds and EmptyVAO the full-screen triangle,
+// which needs no data.
+GLuint SeedVAO, EmptyVAO;
+GLuint PositionVBO, ColorVBO, PositionTexture, ColorTexture;
+
+// Texture units of the seed positions and colors, after the flooding textures
+#define POSITION_TEXTURE_UNIT 2
+#define COLOR_TEXTURE_UNIT    3
+
+// How many seeds the vertex buffers can hold. The position buffer holds FRAMES_IN_FLIGHT copies.
+int SeedCapacity = 0;
+
+// The position buffer, mapped for as long as it exists, or NULL if persistent mapping isn't
+// supported and the positions are uploaded with glBufferSubData()
+float* MappedPositions = NULL;
+vector<float> SeedPositions;
+
+// Frames in flight: the number of the current frame, whose slot is FrameIndex % FRAMES_IN_FLIGHT,
+// and for each slot the fence signaled when the GPU is done with the frame that last used it
+unsigned int FrameIndex = 0;
+GLsync FrameFences[ FRAMES_IN_FLIGHT ];
+
+// Timestamp queries of each slot, and how many were taken (0 if none are waiting to be read)
+GLuint TimestampQueries[ FRAMES_IN_FLIGHT ][ MAX_FRAME_TIMESTAMPS ];
+int NumTimestamps[ FRAMES_IN_FLIGHT ];
+
+// GPU times summed over the frames read back since the last report, in nanoseconds: drawing the
+// seeds, each pass, and the display pass. The step of a pass is 0 for the dispatch of the
+// compute backend that runs the tiled passes, and NumTiledPasses says how many it ran.
+double SeedTime, PassTimes[ MAX_SCHEDULE_PASSES ], DisplayTime;
+int PassTimeSteps[ MAX_SCHEDULE_PASSES ];
+int NumTiledPasses = 0;
+int NumTimedPasses = 0, NumTimedFrames = 0;
+
+// Render to texture
+#define numTextures 2
+GLuint framebufferId, textureId[ numTextures ];
+GLenum buffersA[] = { GL_COLOR_ATTACHMENT0 };
+GLenum buffersB[] = { GL_COLOR_ATTACHMENT1 };
+int curTexture = 0;
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Allocate the flooding textures at the current buffer dimensions
+void AllocateFBOTextures( void ) {
+
+	for( int i = 0; i < numTextures; ++i ) {
+		glBindTexture( GL_TEXTURE_RECTANGLE, textureId[ i ] );
+		glTexImage2D( GL_TEXTURE_RECTANGLE, 0, GL_R32UI, BufferWidth, BufferHeight, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0 );
+	}
+
+	glBindTexture( GL_TEXTURE_RECTANGLE, 0 );
+
+}
+
+// Create the framebuffer object and its components. Each set of buffers is a single attachment
+// holding the index of each pixel's closest seed.
+void CreateFBO( int width, int height ) {
+
+	BufferWidth  = width;
+	BufferHeight = height;
+
+	// Create a texture object
+	printf( "Creating texture object. " );
+	glGenTextures( numTextures, &textureId[0] );
+	for( int i = 0; i < numTextures; ++i ) {
+		glBindTexture( GL_TEXTURE_RECTANGLE, textureId[ i ] );
+		glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	}
+	AllocateFBOTextures();
+	printf( "Finished.\n" );
+
+	// Create a framebuffer object
+	printf( "Creating framebuffer object. " );
+	glGenFramebuffers( 1, &framebufferId );
+	glBindFramebuffer( GL_FRAMEBUFFER, framebufferId );
+	printf( "Finished.\n" );
+
+	// Attach the texture object to the framebuffer color attachment point
+	printf( "Attaching texture object to the FBO. " );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_RECTANGLE, textureId[0], 0 );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_RECTANGLE, textureId[1], 0 );
+	printf( "Finished.\n" );
+
+	// Check status
+	checkFramebufferStatus();
+
+	// Switch back to window-system-provided framebuffer
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+}
+
+// Reallocate the flooding textures if the window's size changed. The attachments keep referring
+// to the same textures, so the FBO itself doesn't change.
+void ResizeFBO( int width, int height ) {
+
+	if( width == BufferWidth && height == BufferHeight )
+		return;
+
+	BufferWidth  = width;
+	BufferHeight = height;
+
+	AllocateFBOTextures();
+
+}
+
+// Release a set of programs: the ones in use, or the ones replaced by ReloadShaderPrograms()
+void DestroyShaderPrograms( const GLuint* progs, const GLuint* jumpProgs, const GLuint* compProgs ) {
+
+	for( int i = 0; i < numShaders; ++i ) {
+		DestroyProgram( progs[i] );
+	}
+
+	for( int i = 0; i < numJumpVariants; ++i )
+		DestroyProgram( jumpProgs[i] );
+
+	if( Backend == COMPUTE_BACKEND )
+		for( int i = 0; i < numComputeShaders; ++i )
+			DestroyProgram( compProgs[i] );
+
+}
+
+// Release the programs
+void DestroyShaderPrograms( void ) {
+
+	DestroyShaderPrograms( progID, jumpProgID, compProgID );
+
+}
+
+// Looking uniforms up is slow, so it's done once for each set of programs instead of every frame
+void GetUniformLocations( void ) {
+
+	for( int i = 0; i < numJumpVariants; ++i ) {
+		uJumpTex0Loc[i]       = glGetUniformLocation( jumpProgID[i], "tex0" );
+		uJumpSeedsLoc[i]      = glGetUniformLocation( jumpProgID[i], "seeds" );
+		uJumpSeedOffsetLoc[i] = glGetUniformLocation( jumpProgID[i], "seedOffset" );
+		uJumpWidthLoc[i]      = glGetUniformLocation( jumpProgID[i], "width" );
+		uJumpHeightLoc[i]     = glGetUniformLocation( jumpProgID[i], "height" );
+		uJumpStepLoc[i]       = glGetUniformLocation( jumpProgID[i], "step" );
+	}
+
+	uTextureTexLoc    = glGetUniformLocation( progID[ TEXTURE_SHADER ], "tex" );
+	uTextureColorsLoc = glGetUniformLocation( progID[ TEXTURE_SHADER ], "colors" );
+
+	uMarkerColorLoc = glGetUniformLocation( progID[ MARKER_SHADER ], "color" );
+
+	if( Backend == COMPUTE_BACKEND ) {
+
+		for( int i = 0; i < numComputeShaders; ++i ) {
+			uCompSrcLoc[i]        = glGetUniformLocation( compProgID[i], "src" );
+			uCompDstLoc[i]        = glGetUniformLocation( compProgID[i], "dst" );
+			uCompSeedsLoc[i]      = glGetUniformLocation( compProgID[i], "seeds" );
+			uCompSeedOffsetLoc[i] = glGetUniformLocation( compProgID[i], "seedOffset" );
+			uCompSizeLoc[i]       = glGetUniformLocation( compProgID[i], "size" );
+		}
+
+		uCompStepLoc     = glGetUniformLocation( compProgID[ JUMP_COMPUTE_SHADER ], "step" );
+		uCompStepsLoc    = glGetUniformLocation( compProgID[ TILE_COMPUTE_SHADER ], "steps" );
+		uCompNumStepsLoc = glGetUniformLocation( compProgID[ TILE_COMPUTE_SHADER ], "numSteps" );
+		uCompApronLoc    = glGetUniformLocation( compProgID[ TILE_COMPUTE_SHADER ], "apron" );
+
+	}
+
+}
+
+// Create the programs from the shaders in shaders/
+void CreateShaderPrograms( void ) {
+
+	progID[ CPOS_SHADER ]    = CreateProgram( "cpos.vert", "cpos.frag" );
+	progID[ TEXTURE_SHADER ] = CreateProgram( "tex.vert", "tex.frag" );
+	progID[ MARKER_SHADER ]  = CreateProgram( "marker.vert", "marker.frag" );
+
+	jumpProgID[ JUMP_BORDER_VARIANT ]   = CreateProgram( "jump.vert", "jump.frag", "#define BORDER" );
+	jumpProgID[ JUMP_INTERIOR_VARIANT ] = CreateProgram( "jump.vert", "jump.frag" );
+	for( int i = 0; i < numConstStepVariants; ++i ) {
+		char defines[32];
+		sprintf( defines, "#define STEP %i", 1 << i );
+		jumpProgID[ JUMP_STEP_1_VARIANT + i ] = CreateProgram( "jump.vert", "jump.frag", defines );
+	}
+
+	if( Backend == COMPUTE_BACKEND ) {
+		compProgID[ JUMP_COMPUTE_SHADER ] = CreateComputeProgram( "jump.comp" );
+		compProgID[ TILE_COMPUTE_SHADER ] = CreateComputeProgram( "tile.comp" );
+	}
+
+	GetUniformLocations();
+
+}
+
+// Whether every program linked
+bool ShaderProgramsLinked( void ) {
+
+	for( int i = 0; i < numShaders; ++i )
+		if( IsProgramLinked( progID[i] ) == false )
+			return false;
+
+	for( int i = 0; i < numJumpVariants; ++i )
+		if( IsProgramLinked( jumpProgID[i] ) == false )
+			return false;
+
+	if( Backend == COMPUTE_BACKEND )
+		for( int i = 0; i < numComputeShaders; ++i )
+			if( IsProgramLinked( compProgID[i] ) == false )
+				return false;
+
+	return true;
+
+}
+
+// Recreate the programs if their files changed, when reading them from a shader directory. The
+// new programs only replace the old ones if they all link, so a mistake in an edited shader
+// leaves the last working ones running until it's fixed.
+void ReloadShaderPrograms( void ) {
+
+	if( ShaderFilesChanged() == false )
+		return;
+
+	GLuint oldProgID[ numShaders ], oldJumpProgID[ numJumpVariants ], oldCompProgID[ numComputeShaders ];
+	memcpy( oldProgID, progID, sizeof( progID ) );
+	memcpy( oldJumpProgID, jumpProgID, sizeof( jumpProgID ) );
+	memcpy( oldCompProgID, compProgID, sizeof( compProgID ) );
+
+	CreateShaderPrograms();
+
+	if( ShaderProgramsLinked() == true ) {
+		DestroyShaderPrograms( oldProgID, oldJumpProgID, oldCompProgID );
+		return;
+	}
+
+	DestroyShaderPrograms();
+	memcpy( progID, oldProgID, sizeof( progID ) );
+	memcpy( jumpProgID, oldJumpProgID, sizeof( jumpProgID ) );
+	memcpy( compProgID, oldCompProgID, sizeof( compProgID ) );
+	GetUniformLocations();
+
+	printf( "The edited shaders don't build, the previous programs are kept.\n" );
+
+}
+
+// Create the vertex arrays for the seeds and the full-screen triangle
+void CreateVertexArrays( void ) {
+
+	glGenVertexArrays( 1, &SeedVAO );
+	glGenVertexArrays( 1, &EmptyVAO );
+	glGenBuffers( 1, &PositionVBO );
+	glGenBuffers( 1, &ColorVBO );
+
+	glBindVertexArray( SeedVAO );
+	glEnableVertexAttribArray( POSITION_ATTRIB );
+	glBindVertexArray( 0 );
+
+	// The positions are read as a texture too, once UploadSeeds() creates their buffer
+	glGenTextures( 1, &PositionTexture );
+
+	// The colors are read as a texture, 4 bytes per seed
+	glBindBuffer( GL_TEXTURE_BUFFER, ColorVBO );
+	glBufferData( GL_TEXTURE_BUFFER, 4, NULL, GL_STATIC_DRAW );
+	glGenTextures( 1, &ColorTexture );
+	glBindTexture( GL_TEXTURE_BUFFER, ColorTexture );
+	glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA8, ColorVBO );
+	glBindTexture( GL_TEXTURE_BUFFER, 0 );
+	glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+	for( int i = 0; i < FRAMES_IN_FLIGHT; ++i )
+		glGenQueries( MAX_FRAME_TIMESTAMPS, TimestampQueries[i] );
+
+}
+
+// Blocks until the GPU is done with the frame that last used a slot
+void WaitForFrame( int slot ) {
+
+	if( FrameFences[ slot ] == NULL )
+		return;
+
+	// The first wait flushes, so that the fence is sure to be signaled eventually
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while( glClientWaitSync( FrameFences[ slot ], flags, 1000000000 ) == GL_TIMEOUT_EXPIRED )
+		flags = 0;
+
+	glDeleteSync( FrameFences[ slot ] );
+	FrameFences[ slot ] = NULL;
+
+}
+
+// Adds the timestamps of a finished frame to the pass times
+void ReadTimestamps( int slot ) {
+
+	int count = NumTimestamps[ slot ];
+	if( count == 0 )
+		return;
+
+	NumTimestamps[ slot ] = 0;
+
+	// The schedule changed since the last frames, so start over
+	if( count - 3 != NumTimedPasses ) {
+		NumTimedPasses = count - 3;
+		NumTimedFrames = 0;
+	}
+
+	if( NumTimedFrames == 0 ) {
+		SeedTime = DisplayTime = 0;
+		for( int i = 0; i < NumTimedPasses; ++i )
+			PassTimes[i] = 0;
+	}
+
+	GLuint64 times[ MAX_FRAME_TIMESTAMPS ];
+	for( int i = 0; i < count; ++i )
+		glGetQueryObjectui64v( TimestampQueries[ slot ][i], GL_QUERY_RESULT, &times[i] );
+
+	SeedTime += times[1] - times[0];
+	for( int i = 0; i < NumTimedPasses; ++i )
+		PassTimes[i] += times[ i + 2 ] - times[ i + 1 ];
+	DisplayTime += times[ count - 1 ] - times[ count - 2 ];
+
+	++NumTimedFrames;
+
+}
+
+// Prints the average GPU times since the last report, and starts over
+void PrintPassTimes( void ) {
+
+	if( NumTimedFrames == 0 )
+		return;
+
+	double total = SeedTime + DisplayTime;
+	for( int i = 0; i < NumTimedPasses; ++i )
+		total += PassTimes[i];
+
+	printf( "GPU time per frame: %.3f ms (seeds %.3f ms, display %.3f ms)\n",
+	        total / NumTimedFrames / 1e6, SeedTime / NumTimedFrames / 1e6, DisplayTime / NumTimedFrames / 1e6 );
+
+	for( int i = 0; i < NumTimedPasses; ++i ) {
+		if( PassTimeSteps[i] == 0 )
+			printf( "  pass %2i, %2i tiled passes: %.3f ms\n", i, NumTiledPasses, PassTimes[i] / NumTimedFrames / 1e6 );
+		else
+			printf( "  pass %2i, step %5i: %.3f ms\n", i, PassTimeSteps[i], PassTimes[i] / NumTimedFrames / 1e6 );
+	}
+
+	NumTimedFrames = 0;
+
+}
+
+// Drops the GPU times gathered so far
+void ResetPassTimes( void ) {
+
+	NumTimedFrames = 0;
+
+}
+
+// Records a GPU timestamp of the current frame
+void TakeTimestamp( int slot ) {
+
+	glQueryCounter( TimestampQueries[ slot ][ NumTimestamps[ slot ]++ ], GL_TIMESTAMP );
+
+}
+
+// Make the vertex buffers hold the current seeds. Positions are written by UploadSeedPositions().
+void UploadSeeds( void ) {
+
+	int numSeeds = Seeds.NumSeeds();
+
+	// Buffer storage is immutable, so a larger buffer means a new one. The GPU may still be
+	// reading the old one, which GL keeps alive until then.
+	if( numSeeds > SeedCapacity ) {
+
+		if( MappedPositions != NULL ) {
+			glBindBuffer( GL_ARRAY_BUFFER, PositionVBO );
+			glUnmapBuffer( GL_ARRAY_BUFFER );
+			MappedPositions = NULL;
+		}
+
+		glDeleteBuffers( 1, &PositionVBO );
+		glGenBuffers( 1, &PositionVBO );
+
+		SeedCapacity = numSeeds;
+		GLsizeiptr size = FRAMES_IN_FLIGHT * SeedCapacity * 2 * sizeof( float );
+
+		glBindBuffer( GL_ARRAY_BUFFER, PositionVBO );
+
+		if( GLEW_ARB_buffer_storage ) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage( GL_ARRAY_BUFFER, size, NULL, flags );
+			MappedPositions = (float*)glMapBufferRange( GL_ARRAY_BUFFER, 0, size, flags );
+		}
+		else
+			glBufferData( GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW );
+
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+		// Point the position texture at the new buffer
+		glBindTexture( GL_TEXTURE_BUFFER, PositionTexture );
+		glTexBuffer( GL_TEXTURE_BUFFER, GL_RG32F, PositionVBO );
+		glBindTexture( GL_TEXTURE_BUFFER, 0 );
+
+		glBindBuffer( GL_TEXTURE_BUFFER, ColorVBO );
+		glBufferData( GL_TEXTURE_BUFFER, SeedCapacity * 4, NULL, GL_STATIC_DRAW );
+		glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+	}
+
+	// The colors don't change until the seeds are created again, and are stored just as the
+	// texture wants them
+	glBindBuffer( GL_TEXTURE_BUFFER, ColorVBO );
+	if( numSeeds > 0 )
+		glBufferSubData( GL_TEXTURE_BUFFER, 0, numSeeds * 4, Seeds.Colors() );
+	glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+}
+
+// Move the seeds by their velocities over delta milliseconds, writing their new positions into a
+// slot's copy of them in the vertex buffer, which the GPU must be done with, and point the seed
+// vertex array at it
+void UploadSeedPositions( int slot, double delta ) {
+
+	int numSeeds = Seeds.NumSeeds();
+	GLintptr offset = (GLintptr)slot * SeedCapacity * 2 * sizeof( float );
+
+	// Straight into the mapped buffer, or into memory to be copied into it in one call
+	float* positions;
+	if( MappedPositions != NULL )
+		positions = MappedPositions + slot * SeedCapacity * 2;
+	else {
+		SeedPositions.resize( numSeeds * 2 );
+		positions = &SeedPositions[0];
+	}
+
+	Seeds.Integrate( (float)( delta / 1000 ), positions );
+
+	glBindBuffer( GL_ARRAY_BUFFER, PositionVBO );
+
+	if( MappedPositions == NULL && numSeeds > 0 )
+		glBufferSubData( GL_ARRAY_BUFFER, offset, numSeeds * 2 * sizeof( float ), positions );
+
+	glBindVertexArray( SeedVAO );
+	glVertexAttribPointer( POSITION_ATTRIB, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)offset );
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+}
+
+// Draws a triangle covering the entire screen, whose corners come from gl_VertexID
+void plane( void ) {
+
+	glBindVertexArray( EmptyVAO );
+	glDrawArrays( GL_TRIANGLES, 0, 3 );
+
+}
+
+int GetFirstStep( void ) {
+
+	int step = 1;
+	while( step*2 < BufferWidth || step*2 < BufferHeight ) step *= 2;
+
+	return step;
+
+}
+
+// Draws the full-screen triangle clipped to a rectangle of the buffers, if it isn't empty. The
+// viewport doesn't change gl_FragCoord, so the shaders still see where in the buffers they are.
+void DrawRectangle( int x0, int y0, int x1, int y1 ) {
+
+	if( x1 <= x0 || y1 <= y0 )
+		return;
+
+	glViewport( x0, y0, x1 - x0, y1 - y0 );
+	plane();
+
+}
+
+// Switches to a variant of the jump flooding shader for a pass
+void UseJumpVariant( int variant, int step, int src ) {
+
+	glUseProgram( jumpProgID[ variant ] );
+	glUniform1i( uJumpTex0Loc[ variant ], src );
+
+	// Variants with a constant step have no uniform for it, and GL ignores location -1
+	glUniform1f( uJumpStepLoc[ variant ], (float)step );
+
+}
+
+// Runs the jump flooding passes by drawing with jump.frag, starting from the first set of
+// buffers. Each pass draws the inner rectangle, whose neighbors are all inside the buffers, with
+// a variant that doesn't check for that, and the strips around it with one that does. Returns
+// the index of the texture holding the result.
+int FloodFragment( const int* steps, int numPasses, int slot ) {
+
+	// Activate textures
+	for( int i = 0; i < numTextures; ++i ) {
+		glActiveTexture( GL_TEXTURE0 + i );
+		glBindTexture( GL_TEXTURE_RECTANGLE, textureId[i] );
+	}
+
+	// Send the uniforms that are the same in every pass. This frame's positions are in its slot's
+	// part of the buffer.
+	for( int i = 0; i < numJumpVariants; ++i ) {
+		glUseProgram( jumpProgID[i] );
+		glUniform1i( uJumpSeedsLoc[i], POSITION_TEXTURE_UNIT );
+		glUniform1i( uJumpSeedOffsetLoc[i], slot * SeedCapacity );
+		glUniform1f( uJumpWidthLoc[i], (float)BufferWidth );
+		glUniform1f( uJumpHeightLoc[i], (float)BufferHeight );
+	}
+
+	bool readingAttach0 = true;
+
+	// Jump flooding iterations
+	for( int pass = 0; pass < numPasses; ++pass ) {
+
+		int step = steps[ pass ];
+		int src  = readingAttach0 == true ? 0 : 1;
+
+		// Set rendering destination to the other set of buffers
+		glDrawBuffers( 1, readingAttach0 == true ? buffersB : buffersA );
+
+		// The inner rectangle, which is empty when the step is at least half the buffers' size
+		int x0 = min( step, BufferWidth ),  x1 = max( BufferWidth - step, x0 );
+		int y0 = min( step, BufferHeight ), y1 = max( BufferHeight - step, y0 );
+
+		int variant = JUMP_INTERIOR_VARIANT;
+		for( int i = 0; i < numConstStepVariants; ++i )
+			if( step == 1 << i )
+				variant = JUMP_STEP_1_VARIANT + i;
+
+		UseJumpVariant( variant, step, src );
+		DrawRectangle( x0, y0, x1, y1 );
+
+		// The strips along the bottom, top, left and right edges
+		UseJumpVariant( JUMP_BORDER_VARIANT, step, src );
+		DrawRectangle( 0, 0, BufferWidth, y0 );
+		DrawRectangle( 0, y1, BufferWidth, BufferHeight );
+		DrawRectangle( 0, y0, x0, y1 );
+		DrawRectangle( x1, y0, BufferWidth, y1 );
+
+		TakeTimestamp( slot );
+		PassTimeSteps[ pass ] = step;
+
+		// Swap read/write buffers
+		readingAttach0 = !readingAttach0;
+	}
+
+	glViewport( 0, 0, BufferWidth, BufferHeight );
+
+	return readingAttach0 == true ? 0 : 1;
+
+}
+
+// Sets the uniforms a compute shader shares with the other one, and binds the images it reads
+// and writes
+void BindComputeShader( int shader, int src, int slot ) {
+
+	glUseProgram( compProgID[ shader ] );
+
+	glBindImageTexture( 0, textureId[ src ], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI );
+	glBindImageTexture( 1, textureId[ 1 - src ], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI );
+
+	glUniform1i( uCompSrcLoc[ shader ], 0 );
+	glUniform1i( uCompDstLoc[ shader ], 1 );
+	glUniform1i( uCompSeedsLoc[ shader ], POSITION_TEXTURE_UNIT );
+	glUniform1i( uCompSeedOffsetLoc[ shader ], slot * SeedCapacity );
+	glUniform2i( uCompSizeLoc[ shader ], BufferWidth, BufferHeight );
+
+}
+
+// Runs the jump flooding passes with compute shaders, starting from the first texture: the
+// trailing passes whose steps add up to at most MAX_APRON in one dispatch of tile.comp, and the
+// ones before them one by one with jump.comp. Returns the index of the texture holding the result.
+int FloodCompute( const int* steps, int numPasses, int slot ) {
+
+	int firstTiled = numPasses;
+	int apron = 0;
+
+	while( firstTiled > 0 && numPasses - firstTiled < MAX_TILE_PASSES && apron + steps[ firstTiled - 1 ] <= MAX_APRON )
+		apron += steps[ --firstTiled ];
+
+	int src = 0;
+	int timed = 0;
+
+	// The passes with large steps
+	if( firstTiled > 0 )
+		BindComputeShader( JUMP_COMPUTE_SHADER, src, slot );
+
+	for( int pass = 0; pass < firstTiled; ++pass ) {
+
+		glUniform1i( uCompStepLoc, steps[ pass ] );
+		glDispatchCompute( ( BufferWidth + JUMP_GROUP_SIZE - 1 ) / JUMP_GROUP_SIZE,
+		                   ( BufferHeight + JUMP_GROUP_SIZE - 1 ) / JUMP_GROUP_SIZE, 1 );
+
+		// The next pass reads what this one wrote
+		glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+
+		TakeTimestamp( slot );
+		PassTimeSteps[ timed++ ] = steps[ pass ];
+
+		src = 1 - src;
+		glBindImageTexture( 0, textureId[ src ], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI );
+		glBindImageTexture( 1, textureId[ 1 - src ], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI );
+
+	}
+
+	// The passes with small steps, all at once
+	if( firstTiled < numPasses ) {
+
+		BindComputeShader( TILE_COMPUTE_SHADER, src, slot );
+
+		glUniform1iv( uCompStepsLoc, numPasses - firstTiled, steps + firstTiled );
+		glUniform1i( uCompNumStepsLoc, numPasses - firstTiled );
+		glUniform1i( uCompApronLoc, apron );
+
+		glDispatchCompute( ( BufferWidth + TILE_SIZE - 1 ) / TILE_SIZE, ( BufferHeight + TILE_SIZE - 1 ) / TILE_SIZE, 1 );
+
+		TakeTimestamp( slot );
+		PassTimeSteps[ timed++ ] = 0;
+		NumTiledPasses = numPasses - firstTiled;
+
+		src = 1 - src;
+
+	}
+
+	// The display pass samples the result, readbacks copy it with glGetTexImage(), and the next
+	// frame draws its seeds into the textures
+	glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+
+	return src;
+
+}
+
+// Creates everything the pipeline needs in the current context
+void InitializeRenderer( int width, int height ) {
+
+	glDisable( GL_DEPTH_TEST );
+	glDisable( GL_BLEND );
+
+	// Create shaders and vertex arrays
+	CreateShaderPrograms();
+	CreateVertexArrays();
+
+	// Create framebuffer and its components
+	CreateFBO( width, height );
+
+}
+
+// Waits for the frame's slot and gives the seeds their positions for this frame
+int BeginFrame( double delta ) {
+
+	// The GPU may still be busy with the previous frame, but this one's slot was last used by the
+	// frame before, which is all we have to wait for
+	int slot = FrameIndex % FRAMES_IN_FLIGHT;
+	WaitForFrame( slot );
+	ReadTimestamps( slot );
+
+	// Apply velocities
+	UploadSeedPositions( slot, delta );
+
+	TakeTimestamp( slot );
+
+	return slot;
+
+}
+
+// Renders the seeds to texture and floods them
+void FloodFrame( int slot ) {
+
+	/*===============================================================================
+	  RENDER POINTS TO TEXTURE
+	===============================================================================*/
+
+	// Bind our framebuffer
+	glBindFramebuffer( GL_FRAMEBUFFER, framebufferId );
+
+	// Set the rendering destination to first set of buffers
+	glDrawBuffers( 1, buffersA );
+	glViewport( 0, 0, BufferWidth, BufferHeight );
+
+	// Clear the buffer, marking every pixel as having no closest seed yet
+	const GLuint noSeed[4] = { NO_SEED, 0, 0, 0 };
+	glClearBufferuiv( GL_COLOR, 0, noSeed );
+
+	// Shader that simply stores the point's index
+	glUseProgram( progID[ CPOS_SHADER ] );
+
+	// Draw the seeds into the texture
+	glPointSize( 1 );
+	glBindVertexArray( SeedVAO );
+	glDrawArrays( GL_POINTS, 0, Seeds.NumSeeds() );
+
+	TakeTimestamp( slot );
+
+	/*===============================================================================
+	  EXECUTE JUMP FLOODING
+	===============================================================================*/
+
+	// Plain jump flooding halves the step down to 1, the other schedules add passes
+	int steps[ MAX_SCHEDULE_PASSES ];
+	NumPasses = GetStepSchedule( Schedule, GetFirstStep(), steps );
+
+	// The seeds' positions are read from this frame's slot of the position buffer
+	glActiveTexture( GL_TEXTURE0 + POSITION_TEXTURE_UNIT );
+	glBindTexture( GL_TEXTURE_BUFFER, PositionTexture );
+
+	// For rendering, use the texture that was written to last. Commands run in order, so jump
+	// flooding is finished before the display pass reads it without waiting here.
+	if( Backend == COMPUTE_BACKEND )
+		curTexture = FloodCompute( steps, NumPasses, slot );
+	else
+		curTexture = FloodFragment( steps, NumPasses, slot );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+}
+
+// The texture the last jump flooding pass wrote to
+GLuint ResultTexture( void ) {
+
+	return textureId[ curTexture ];
+
+}
+
+// Turns each pixel's closest seed into its color
+void DisplayFrame( GLuint framebuffer, bool drawMarkers ) {
+
+	// Switch to the destination, the window-system-provided framebuffer if it's 0
+	glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+	glDrawBuffer( framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0 );
+	glViewport( 0, 0, BufferWidth, BufferHeight );
+
+	// Clear the color buffer
+	glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+	glClear( GL_COLOR_BUFFER_BIT );
+
+	// Renders the texture content on the screen
+	glUseProgram( progID[ TEXTURE_SHADER ] );
+
+	// Activate textures and send uniform variables to the shader program
+	for( int i = 0; i < numTextures; ++i ) {
+		glActiveTexture( GL_TEXTURE0 + i );
+		glBindTexture( GL_TEXTURE_RECTANGLE, textureId[ i ] );
+	}
+
+	glActiveTexture( GL_TEXTURE0 + COLOR_TEXTURE_UNIT );
+	glBindTexture( GL_TEXTURE_BUFFER, ColorTexture );
+
+	glUniform1i( uTextureTexLoc, curTexture );
+	glUniform1i( uTextureColorsLoc, COLOR_TEXTURE_UNIT );
+
+	// Draw a plane over the entire screen to invoke shaders
+	plane();
+
+	// Draw the seeds so we can see where they are, as white squares with a black border
+	if( drawMarkers == true ) {
+
+		glUseProgram( progID[ MARKER_SHADER ] );
+		glBindVertexArray( SeedVAO );
+
+		glPointSize( SeedSize );
+		glUniform4f( uMarkerColorLoc, 0.0f, 0.0f, 0.0f, 1.0f );
+		glDrawArrays( GL_POINTS, 0, Seeds.NumSeeds() );
+
+		glPointSize( SeedSize-2 );
+		glUniform4f( uMarkerColorLoc, 1.0f, 1.0f, 1.0f, 1.0f );
+		glDrawArrays( GL_POINTS, 0, Seeds.NumSeeds() );
+
+	}
+
+}
+
+// Fences the frame and resets the state it left bound
+void EndFrame( int slot ) {
+
+	// Done with this frame's slot once the GPU gets here
+	TakeTimestamp( slot );
+	FrameFences[ slot ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	++FrameIndex;
+
+	// Reset shader, vertex array and texture usage
+	glUseProgram( 0 );
+	glBindVertexArray( 0 );
+	glBindTexture( GL_TEXTURE_BUFFER, 0 );
+	glActiveTexture( GL_TEXTURE0 );
+
+}
@@ -0,0 +1,113 @@
+/*=================================================================================================
+  About: The GPU Jump Flooding pipeline, which needs an OpenGL context but no window. A frame
+   goes through BeginFrame(), which moves and uploads the seeds, FloodFrame(), which draws the
+   seeds and runs the jump flooding passes, DisplayFrame(), which colors the result into a
+   framebuffer, and EndFrame(). Frames are pipelined, so the GPU may still be working on one when
+   the next begins, in one of FRAMES_IN_FLIGHT slots.
+=================================================================================================*/
+
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+#include <GL/glew.h>
+
+#include "schedule.h"
+#include "seedstore.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Frames the GPU may be working on while the CPU prepares the next one, each with its own copy
+// of the seed positions
+#define FRAMES_IN_FLIGHT 2
+
+// Closest seed of the pixels that have none in the result texture
+#define NO_SEED 0xFFFFFFFFu
+
+/*=================================================================================================
+  TYPES
+=================================================================================================*/
+
+// How the jump flooding passes are run
+enum FloodBackend {
+	FRAGMENT_BACKEND = 0,
+	COMPUTE_BACKEND
+};
+
+/*=================================================================================================
+  GLOBALS
+=================================================================================================*/
+
+// The seeds. UploadSeeds() must be called after adding or removing any.
+extern SeedStore Seeds;
+
+// How large to draw each seed's marker
+extern int SeedSize;
+
+// Dimensions of the flooding buffers
+extern int BufferWidth, BufferHeight;
+
+// Step schedule of the jump flooding passes, and how many passes it took in the last frame
+extern StepSchedule Schedule;
+extern int NumPasses;
+
+// Backend of the jump flooding passes. It must be set before InitializeRenderer(), and the
+// compute backend needs an OpenGL 4.3 context.
+extern FloodBackend Backend;
+
+// Number of the current frame, counting from 0
+extern unsigned int FrameIndex;
+
+/*=================================================================================================
+  FUNCTIONS
+=================================================================================================*/
+
+// Creates the shaders, vertex arrays and flooding buffers, of the given dimensions, in the
+// current context
+void InitializeRenderer( int width, int height );
+
+// Reallocates the flooding buffers at new dimensions
+void ResizeFBO( int width, int height );
+
+// Deletes the shader programs
+void DestroyShaderPrograms( void );
+
+// Recreates the shader programs if their files changed, which is only watched for when they're
+// read from JFA_SHADER_DIR (see shader.h)
+void ReloadShaderPrograms( void );
+
+// Copies the seeds' colors to the GPU, growing the buffers if there are more seeds than they can
+// hold. Their positions are written every frame.
+void UploadSeeds( void );
+
+// Step of the first jump flooding pass: the largest power of two below the buffer size
+int GetFirstStep( void );
+
+// Starts a frame: waits for the GPU to finish the frame that last used its slot, moves the seeds
+// by their velocities over delta milliseconds, and uploads their positions. Returns the slot.
+int BeginFrame( double delta );
+
+// Draws the seeds into the flooding buffers and runs the jump flooding passes
+void FloodFrame( int slot );
+
+// The flooding texture that holds the last frame's result: an R32UI rectangle texture of the
+// buffer dimensions with the index of each pixel's closest seed, or NO_SEED
+GLuint ResultTexture( void );
+
+// Draws the result with each seed's color into a framebuffer of the buffer dimensions, and the
+// seeds' markers over it if asked. Framebuffer 0 is the window's back buffer, any other is drawn
+// through its first color attachment.
+void DisplayFrame( GLuint framebuffer, bool drawMarkers );
+
+// Ends the frame, signaling its slot's fence once the GPU gets here
+void EndFrame( int slot );
+
+// Waits for the GPU to finish the frame that last used a slot
+void WaitForFrame( int slot );
+
+// Prints the average GPU time of each pass since the last call, or the last ResetPassTimes()
+void PrintPassTimes( void );
+void ResetPassTimes( void );
+
+#endif
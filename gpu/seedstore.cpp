@@ -0,0 +1,198 @@
+/*=================================================================================================
+  About: Implementation of the seed store declared in seedstore.h.
+=================================================================================================*/
+
+/*=================================================================================================
+  INCLUDES
+=================================================================================================*/
+
+#include <stddef.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#include "seedstore.h"
+#include "threadpool.h"
+
+/*=================================================================================================
+  DEFINES
+=================================================================================================*/
+
+// Fewer seeds than this per thread aren't worth waking the threads for
+#define MIN_SEEDS_PER_THREAD 65536
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+SeedStore::SeedStore( void ) :
+	Pool( NULL ),
+	PoolCreated( false ),
+	TaskSeconds( 0 ),
+	TaskPositions( NULL ),
+	TaskNumThreads( 1 ) {
+
+}
+
+SeedStore::~SeedStore( void ) {
+
+	delete Pool;
+
+}
+
+void SeedStore::Clear( void ) {
+
+	X.clear();
+	Y.clear();
+	VX.clear();
+	VY.clear();
+	ColorBytes.clear();
+
+}
+
+void SeedStore::Reserve( int numSeeds ) {
+
+	X.reserve( numSeeds );
+	Y.reserve( numSeeds );
+	VX.reserve( numSeeds );
+	VY.reserve( numSeeds );
+	ColorBytes.reserve( (size_t)numSeeds * 4 );
+
+}
+
+void SeedStore::Add( float x, float y, float r, float g, float b, float vx, float vy ) {
+
+	X.push_back( x );
+	Y.push_back( y );
+	VX.push_back( vx );
+	VY.push_back( vy );
+
+	ColorBytes.push_back( (unsigned char)( r * 255 ) );
+	ColorBytes.push_back( (unsigned char)( g * 255 ) );
+	ColorBytes.push_back( (unsigned char)( b * 255 ) );
+	ColorBytes.push_back( 255 );
+
+}
+
+void SeedStore::IntegrateRange( int begin, int end, float seconds, float* positions ) {
+
+	float* x  = X.empty() ? NULL : &X[0];
+	float* y  = Y.empty() ? NULL : &Y[0];
+	float* vx = VX.empty() ? NULL : &VX[0];
+	float* vy = VY.empty() ? NULL : &VY[0];
+
+	int i = begin;
+
+#if defined( __SSE2__ )
+
+	// The same as the scalar loop below, with masks instead of branches: a seed that would leave
+	// the buffers stays put and turns around
+	const __m128 step = _mm_set1_ps( seconds );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one  = _mm_set1_ps( 1.0f );
+	const __m128 sign = _mm_set1_ps( -0.0f );
+
+	for( ; i + 4 <= end; i += 4 ) {
+
+		__m128 px = _mm_loadu_ps( x + i ), py = _mm_loadu_ps( y + i );
+		__m128 qx = _mm_loadu_ps( vx + i ), qy = _mm_loadu_ps( vy + i );
+
+		__m128 newX = _mm_add_ps( px, _mm_mul_ps( qx, step ) );
+		__m128 newY = _mm_add_ps( py, _mm_mul_ps( qy, step ) );
+
+		__m128 outX = _mm_or_ps( _mm_cmplt_ps( newX, zero ), _mm_cmpge_ps( newX, one ) );
+		__m128 outY = _mm_or_ps( _mm_cmplt_ps( newY, zero ), _mm_cmpge_ps( newY, one ) );
+
+		qx = _mm_xor_ps( qx, _mm_and_ps( outX, sign ) );
+		qy = _mm_xor_ps( qy, _mm_and_ps( outY, sign ) );
+		px = _mm_or_ps( _mm_and_ps( outX, px ), _mm_andnot_ps( outX, newX ) );
+		py = _mm_or_ps( _mm_and_ps( outY, py ), _mm_andnot_ps( outY, newY ) );
+
+		_mm_storeu_ps( x + i, px );
+		_mm_storeu_ps( y + i, py );
+		_mm_storeu_ps( vx + i, qx );
+		_mm_storeu_ps( vy + i, qy );
+
+		// Interleave the coordinates into x,y pairs for the vertex buffer
+		_mm_storeu_ps( positions + 2*i,     _mm_unpacklo_ps( px, py ) );
+		_mm_storeu_ps( positions + 2*i + 4, _mm_unpackhi_ps( px, py ) );
+
+	}
+
+#endif
+
+	for( ; i < end; ++i ) {
+
+		float newX = x[i] + vx[i] * seconds;
+		float newY = y[i] + vy[i] * seconds;
+
+		if( newX < 0.0f || newX >= 1.0f )
+			vx[i] = -vx[i];
+		else
+			x[i] = newX;
+
+		if( newY < 0.0f || newY >= 1.0f )
+			vy[i] = -vy[i];
+		else
+			y[i] = newY;
+
+		positions[ 2*i ]     = x[i];
+		positions[ 2*i + 1 ] = y[i];
+
+	}
+
+}
+
+void SeedStore::IntegrateTask( void* arg, int threadIdx, int numThreads ) {
+
+	SeedStore* store = (SeedStore*)arg;
+
+	// Only as many threads as there are enough seeds for take part
+	if( threadIdx >= store->TaskNumThreads )
+		return;
+
+	// Ranges of whole groups of 4, except at the end
+	long long numGroups = ( store->NumSeeds() + 3 ) / 4;
+	int begin = (int)( numGroups * threadIdx / store->TaskNumThreads * 4 );
+	int end   = (int)( numGroups * ( threadIdx + 1 ) / store->TaskNumThreads * 4 );
+	if( end > store->NumSeeds() )
+		end = store->NumSeeds();
+
+	store->IntegrateRange( begin, end, store->TaskSeconds, store->TaskPositions );
+
+}
+
+void SeedStore::Integrate( float seconds, float* positions ) {
+
+	int numSeeds = NumSeeds();
+	int numThreads = numSeeds / MIN_SEEDS_PER_THREAD;
+
+	if( numThreads >= 2 && PoolCreated == false ) {
+
+		// One thread per hardware thread, unless there's only one
+		Pool = new ThreadPool( 0 );
+		PoolCreated = true;
+
+		if( Pool->NumThreads() == 1 ) {
+			delete Pool;
+			Pool = NULL;
+		}
+
+	}
+
+	if( Pool != NULL && numThreads > Pool->NumThreads() )
+		numThreads = Pool->NumThreads();
+
+	if( Pool == NULL || numThreads < 2 ) {
+		IntegrateRange( 0, numSeeds, seconds, positions );
+		return;
+	}
+
+	TaskSeconds    = seconds;
+	TaskPositions  = positions;
+	TaskNumThreads = numThreads;
+
+	Pool->Run( &IntegrateTask, this );
+
+}
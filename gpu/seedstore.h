@@ -0,0 +1,76 @@
+/*=================================================================================================
+  About: The seeds of the GPU implementation, kept as a structure of arrays: positions, velocities
+   and colors each in their own array. Moving them is a sweep over a few float arrays, done 4
+   seeds at a time with SSE2 and, when there are enough seeds to be worth it, split over a pool
+   of threads. The same sweep writes the new positions to the GPU's buffer, so a frame touches
+   each seed once and the positions are uploaded in one go.
+=================================================================================================*/
+
+#ifndef _SEEDSTORE_H_
+#define _SEEDSTORE_H_
+
+#include <stddef.h>
+#include <vector>
+
+class ThreadPool;
+
+/*=================================================================================================
+  CLASSES
+=================================================================================================*/
+
+class SeedStore {
+
+public:
+
+	SeedStore( void );
+	~SeedStore( void );
+
+	int NumSeeds( void ) const { return (int)X.size(); }
+
+	// Removes every seed
+	void Clear( void );
+
+	// Makes room for numSeeds seeds, so adding them doesn't reallocate
+	void Reserve( int numSeeds );
+
+	// Adds a seed at (x,y), from 0 to 1 over the flooding buffers, with a color whose components
+	// go from 0 to 1 and a velocity in those units per second
+	void Add( float x, float y, float r, float g, float b, float vx, float vy );
+
+	// The seeds' colors as RGBA with 8 bits per component, 4 bytes per seed
+	const unsigned char* Colors( void ) const { return ColorBytes.empty() ? NULL : &ColorBytes[0]; }
+
+	// Moves the seeds by their velocities over some seconds, bouncing them off the edges, and
+	// writes their new positions to positions as x,y pairs, 2 floats per seed
+	void Integrate( float seconds, float* positions );
+
+private:
+
+	// Moves seeds [begin,end)
+	void IntegrateRange( int begin, int end, float seconds, float* positions );
+
+	static void IntegrateTask( void* arg, int threadIdx, int numThreads );
+
+	// Not copyable, since we own the pool
+	SeedStore( const SeedStore& );
+	SeedStore& operator=( const SeedStore& );
+
+	// Positions and velocities
+	std::vector<float> X, Y;
+	std::vector<float> VX, VY;
+
+	std::vector<unsigned char> ColorBytes;
+
+	// Created the first time there are enough seeds to split them, and NULL if there's only one
+	// hardware thread
+	ThreadPool* Pool;
+	bool PoolCreated;
+
+	// The sweep being run on the pool
+	float TaskSeconds;
+	float* TaskPositions;
+	int TaskNumThreads;
+
+};
+
+#endif
@@ -1,8 +1,37 @@
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
 
 #include "shader.h"
 #include "textfile.h"
 
+// Name and source of each file in shaders/, embedded by the Makefile
+struct EmbeddedShader {
+	const char* name;
+	const char* source;
+};
+
+static const EmbeddedShader EmbeddedShaders[] = {
+#include "embedded_shaders.h"
+};
+
+#define NUM_EMBEDDED_SHADERS ( sizeof( EmbeddedShaders ) / sizeof( EmbeddedShaders[0] ) )
+
+// Directory the sources are read from instead, and watched for changes, if JFA_SHADER_DIR is set
+static const char* ShaderDirectory = NULL;
+static bool ShaderDirectoryChecked = false;
+
+// Modification times of the files read from that directory
+struct WatchedShader {
+	std::string path;
+	time_t modified;
+};
+static std::vector<WatchedShader> WatchedShaders;
+
 void printShaderInfoLog( GLuint obj )
 {
 	int infologLength = 0;
@@ -37,38 +66,312 @@ void printProgramInfoLog( GLuint obj )
 	}
 }
 
-GLuint CreateShader( const char* shaderPath, GLenum shaderType )
-{
+static const char* GetShaderDirectory( void ) {
+
+	if( ShaderDirectoryChecked == false ) {
+		ShaderDirectory = getenv( "JFA_SHADER_DIR" );
+		if( ShaderDirectory != NULL && ShaderDirectory[0] == '\0' )
+			ShaderDirectory = NULL;
+		if( ShaderDirectory != NULL )
+			printf( "Reading shaders from %s and reloading them when they change.\n", ShaderDirectory );
+		ShaderDirectoryChecked = true;
+	}
+
+	return ShaderDirectory;
+
+}
+
+// The source of a file in shaders/: read from the shader directory if there is one, and the
+// embedded copy otherwise. Returns false if there's no such shader.
+static bool GetShaderSource( const char* name, std::string& source ) {
+
+	const char* directory = GetShaderDirectory();
+
+	if( directory != NULL ) {
+
+		std::string path = std::string( directory ) + "/" + name;
+
+		// Checked before reading, so a change made meanwhile is picked up by the next check
+		struct stat info;
+		char* text = stat( path.c_str(), &info ) == 0 ? textFileRead( path.c_str() ) : NULL;
+		if( text != NULL ) {
+
+			source = text;
+			free( text );
+
+			size_t i = 0;
+			while( i < WatchedShaders.size() && WatchedShaders[i].path != path )
+				++i;
+			if( i == WatchedShaders.size() ) {
+				WatchedShader watched = { path, info.st_mtime };
+				WatchedShaders.push_back( watched );
+			}
+			WatchedShaders[i].modified = info.st_mtime;
+
+			return true;
+
+		}
+
+		printf( "Couldn't read %s, using the built-in copy.\n", path.c_str() );
+
+	}
+
+	for( size_t i = 0; i < NUM_EMBEDDED_SHADERS; ++i ) {
+		if( strcmp( EmbeddedShaders[i].name, name ) == 0 ) {
+			source = EmbeddedShaders[i].source;
+			return true;
+		}
+	}
+
+	printf( "There's no shader named %s.\n", name );
+	return false;
+
+}
+
+bool ShaderFilesChanged( void ) {
+
+	if( GetShaderDirectory() == NULL )
+		return false;
+
+	bool changed = false;
+
+	for( size_t i = 0; i < WatchedShaders.size(); ++i ) {
+		struct stat info;
+		if( stat( WatchedShaders[i].path.c_str(), &info ) == 0 && info.st_mtime != WatchedShaders[i].modified ) {
+			printf( "%s changed.\n", WatchedShaders[i].path.c_str() );
+			WatchedShaders[i].modified = info.st_mtime;
+			changed = true;
+		}
+	}
+
+	return changed;
+
+}
+
+// 64-bit FNV-1a hash, continuing from a previous one
+static unsigned long long HashBytes( unsigned long long hash, const void* data, size_t size ) {
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	for( size_t i = 0; i < size; ++i ) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+
+}
+
+static unsigned long long HashString( unsigned long long hash, const char* text ) {
+
+	return HashBytes( hash, text, strlen( text ) + 1 );
+
+}
+
+// The file a program binary is cached in, or an empty string if binaries can't be cached. The
+// name hashes the driver and the program's sources, so a change in either means a new file.
+static std::string GetCacheFile( int numStages, const GLenum* types, const std::string* sources ) {
+
+	// Core since 4.1, and an extension before
+	GLint numFormats = 0;
+	if( GLEW_ARB_get_program_binary )
+		glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+	if( numFormats == 0 )
+		return std::string();
+
+	// Like other caches, under $XDG_CACHE_HOME, or ~/.cache
+	std::string directory;
+	if( getenv( "XDG_CACHE_HOME" ) != NULL && getenv( "XDG_CACHE_HOME" )[0] != '\0' )
+		directory = getenv( "XDG_CACHE_HOME" );
+	else if( getenv( "HOME" ) != NULL )
+		directory = std::string( getenv( "HOME" ) ) + "/.cache";
+	else
+		return std::string();
+
+	mkdir( directory.c_str(), 0755 );
+	directory += "/jfa-voronoi";
+	if( mkdir( directory.c_str(), 0755 ) != 0 && errno != EEXIST )
+		return std::string();
+
+	unsigned long long hash = 0xCBF29CE484222325ull;
+	hash = HashString( hash, (const char*)glGetString( GL_VENDOR ) );
+	hash = HashString( hash, (const char*)glGetString( GL_RENDERER ) );
+	hash = HashString( hash, (const char*)glGetString( GL_VERSION ) );
+	for( int i = 0; i < numStages; ++i ) {
+		hash = HashBytes( hash, &types[i], sizeof( types[i] ) );
+		hash = HashString( hash, sources[i].c_str() );
+	}
+
+	char name[32];
+	snprintf( name, sizeof( name ), "/%016llx.bin", hash );
+
+	return directory + name;
+
+}
+
+// Loads a cached program binary into a program. Returns false if there's none, or the driver
+// rejects it.
+static bool LoadProgramBinary( GLuint progID, const std::string& cacheFile ) {
+
+	FILE* file = fopen( cacheFile.c_str(), "rb" );
+	if( file == NULL )
+		return false;
+
+	// The binary's format, followed by the binary
+	GLenum format;
+	std::vector<char> binary;
+	bool valid = fread( &format, sizeof( format ), 1, file ) == 1;
+	if( valid == true ) {
+		fseek( file, 0, SEEK_END );
+		long size = ftell( file ) - (long)sizeof( format );
+		fseek( file, sizeof( format ), SEEK_SET );
+		valid = size > 0;
+		if( valid == true ) {
+			binary.resize( size );
+			valid = fread( &binary[0], size, 1, file ) == 1;
+		}
+	}
+	fclose( file );
+
+	if( valid == false )
+		return false;
+
+	glProgramBinary( progID, format, &binary[0], binary.size() );
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv( progID, GL_LINK_STATUS, &linked );
+
+	return linked == GL_TRUE;
+
+}
+
+static void SaveProgramBinary( GLuint progID, const std::string& cacheFile ) {
+
+	GLint size = 0;
+	glGetProgramiv( progID, GL_PROGRAM_BINARY_LENGTH, &size );
+	if( size <= 0 )
+		return;
+
+	GLenum format;
+	std::vector<char> binary( size );
+	glGetProgramBinary( progID, size, NULL, &format, &binary[0] );
+
+	// Written under another name first, so another instance never reads half a file
+	std::string temporary = cacheFile + ".tmp";
+	FILE* file = fopen( temporary.c_str(), "wb" );
+	if( file == NULL )
+		return;
+
+	bool valid = fwrite( &format, sizeof( format ), 1, file ) == 1 && fwrite( &binary[0], size, 1, file ) == 1;
+	if( fclose( file ) == 0 && valid == true )
+		rename( temporary.c_str(), cacheFile.c_str() );
+	else
+		remove( temporary.c_str() );
+
+}
+
+static GLuint CompileShader( const std::string& source, GLenum shaderType ) {
+
 	GLuint shaderID = glCreateShader( shaderType );
 
 	if( shaderID > 0 ) {
-		char* shaderSource = textFileRead( shaderPath );
-		const char* shaderSrc = shaderSource;
+		const char* shaderSrc = source.c_str();
 		glShaderSource( shaderID, 1, &shaderSrc, NULL );
-		free( shaderSource );
 		glCompileShader( shaderID );
 		printShaderInfoLog( shaderID );
 	}
 
 	return shaderID;
+
 }
 
-GLuint CreateProgram( GLuint vertID, GLuint fragID )
-{
+// Puts lines of #defines right after a source's #version line, which must come first
+static void InsertDefines( std::string& source, const char* defines ) {
+
+	if( defines == NULL || defines[0] == '\0' )
+		return;
+
+	size_t lineEnd = source.find( '\n' );
+	if( lineEnd == std::string::npos ) {
+		source += '\n';
+		lineEnd = source.size() - 1;
+	}
+
+	source.insert( lineEnd + 1, std::string( defines ) + "\n" );
+
+}
+
+// Creates a program from shaders/ files, from the binary cache if possible. The shader objects
+// are only needed for linking, so they're deleted right after.
+static GLuint LoadProgram( int numStages, const GLenum* types, const char* const* names, const char* defines ) {
+
+	// The defines are part of the sources, so each variant gets its own cache entry
+	std::string sources[2];
+	for( int i = 0; i < numStages; ++i ) {
+		if( GetShaderSource( names[i], sources[i] ) == false )
+			return 0;
+		InsertDefines( sources[i], defines );
+	}
+
 	GLuint progID = glCreateProgram();
-	glAttachShader( progID, vertID );
-	glAttachShader( progID, fragID );
+
+	std::string cacheFile = GetCacheFile( numStages, types, sources );
+	if( cacheFile.empty() == false && LoadProgramBinary( progID, cacheFile ) == true )
+		return progID;
+
+	GLuint shaderIDs[2];
+	for( int i = 0; i < numStages; ++i ) {
+		shaderIDs[i] = CompileShader( sources[i], types[i] );
+		glAttachShader( progID, shaderIDs[i] );
+	}
+
+	if( cacheFile.empty() == false )
+		glProgramParameteri( progID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
 	glLinkProgram( progID );
 	printProgramInfoLog( progID );
+
+	for( int i = 0; i < numStages; ++i ) {
+		glDetachShader( progID, shaderIDs[i] );
+		glDeleteShader( shaderIDs[i] );
+	}
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv( progID, GL_LINK_STATUS, &linked );
+	if( linked == GL_TRUE && cacheFile.empty() == false )
+		SaveProgramBinary( progID, cacheFile );
+
 	return progID;
+
 }
 
-void DestroyProgram( GLuint progID, GLuint vertID, GLuint fragID ) {
+GLuint CreateProgram( const char* vertName, const char* fragName, const char* defines )
+{
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* names[] = { vertName, fragName };
+	return LoadProgram( 2, types, names, defines );
+}
+
+GLuint CreateComputeProgram( const char* compName, const char* defines )
+{
+	const GLenum types[] = { GL_COMPUTE_SHADER };
+	const char* names[] = { compName };
+	return LoadProgram( 1, types, names, defines );
+}
+
+void DestroyProgram( GLuint progID ) {
 
-	glDetachShader( progID, vertID );
-	glDetachShader( progID, fragID );
-	glDeleteShader( vertID );
-	glDeleteShader( fragID );
 	glDeleteProgram( progID );
 
 }
+
+// Programs whose sources couldn't be read are 0, and never linked
+bool IsProgramLinked( GLuint progID ) {
+
+	if( progID == 0 )
+		return false;
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv( progID, GL_LINK_STATUS, &linked );
+	return linked == GL_TRUE;
+
+}
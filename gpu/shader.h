@@ -2,12 +2,22 @@
 #define _SHADER_H_
 
 #include <GL/glew.h>
-#include <GL/glut.h>
+
+// Shaders are named by their file in shaders/, whose contents are embedded in the program when
+// it's built, so they're found from any working directory. Linked programs are cached as
+// binaries (when the driver supports it) in $XDG_CACHE_HOME/jfa-voronoi, or ~/.cache/jfa-voronoi,
+// under a hash of the driver and the sources, and later runs load them instead of compiling.
+// For development, setting JFA_SHADER_DIR to the shaders directory reads them from there
+// instead, and ShaderFilesChanged() tells when any of them was saved since it was read.
+// Variants of a shader are made by passing lines of #defines, which are put right after the
+// #version line of each of its stages.
 
 void printShaderInfoLog( GLuint obj );
 void printProgramInfoLog( GLuint obj );
-GLuint CreateShader( const char* shaderPath, GLenum shaderType );
-GLuint CreateProgram( GLuint vertID, GLuint fragID );
-void DestroyProgram( GLuint progID, GLuint vertID, GLuint fragID );
+GLuint CreateProgram( const char* vertName, const char* fragName, const char* defines = NULL );
+GLuint CreateComputeProgram( const char* compName, const char* defines = NULL );
+void DestroyProgram( GLuint progID );
+bool IsProgramLinked( GLuint progID );
+bool ShaderFilesChanged( void );
 
 #endif
@@ -1,7 +1,10 @@
-varying vec4 color;
+#version 330 core
+
+flat in uint seedId;
+
+out uint fragSeedId;
 
 void main()
 {
-	gl_FragData[0] = vec4( gl_FragCoord.st, 0.0, 1.0 );
-	gl_FragData[1] = color;
+	fragSeedId = seedId;
 }
@@ -1,7 +1,11 @@
-varying vec4 color;
+#version 330 core
+
+layout( location = 0 ) in vec2 position; /* seed position, from 0 to 1 */
+
+flat out uint seedId;
 
 void main()
 {
-	color = gl_Color;
-	gl_Position = ftransform();
+	seedId = uint( gl_VertexID );
+	gl_Position = vec4( position * 2.0 - 1.0, 0.0, 1.0 );
 }
@@ -1,53 +1,76 @@
-#extension GL_ARB_texture_rectangle : enable
+#version 330 core
 
-uniform sampler2DRect tex0,tex1; /* the textures to read from */
+/* Variants are made by defining, before this:
+     BORDER  for the strips along the edges, whose neighbors may be outside the texture. Without
+             it, every neighbor must be inside, which is the case for the inner rectangle.
+     STEP    a constant step size, so the neighbors' offsets are constants, instead of the
+             step uniform */
+
+#define NO_SEED 0xFFFFFFFFu
+
+uniform usampler2DRect tex0; /* the texture to read from, with the index of each pixel's closest seed */
+uniform samplerBuffer seeds; /* seed positions, from 0 to 1 */
+uniform int seedOffset; /* where this frame's positions start in seeds */
 uniform float width,height; /* window dimensions */
+
+#ifdef STEP
+const int s = STEP;
+#else
 uniform float step; /* jump flooding step size */
+#endif
+
+out uint fragSeedIdOut;
+
+/* The 8 neighbors, in units of the step */
+const ivec2 offsets[8] = ivec2[8]( ivec2( -1, -1 ), ivec2( 0, -1 ), ivec2( 1, -1 ), ivec2( -1, 0 ),
+                                   ivec2(  1,  0 ), ivec2( -1, 1 ), ivec2( 0,  1 ), ivec2(  1, 1 ) );
+
+/* Squared distance from this fragment to a seed */
+float SeedDistance( uint seedId )
+{
+	vec2 delta = texelFetch( seeds, seedOffset + int( seedId ) ).rg * vec2( width, height ) - gl_FragCoord.st;
+	return dot( delta, delta );
+}
 
 void main()
 {
-	vec4 fragData0,colorData0;
-	vec4 neighbor0;
-	vec2 nCoord[8];
+	uint fragSeedId,neighborSeedId;
+
+	ivec2 coord = ivec2( gl_FragCoord.st );
+#ifndef STEP
+	int s = int( step );
+#endif
 
 	float dist = 0.0;
 	float newDist;
-	int i;
 
-	nCoord[0] = vec2( gl_FragCoord.s - step, gl_FragCoord.t - step );
-	nCoord[1] = vec2( gl_FragCoord.s       , gl_FragCoord.t - step );
-	nCoord[2] = vec2( gl_FragCoord.s + step, gl_FragCoord.t - step );
-	nCoord[3] = vec2( gl_FragCoord.s - step, gl_FragCoord.t        );
-	nCoord[4] = vec2( gl_FragCoord.s + step, gl_FragCoord.t        );
-	nCoord[5] = vec2( gl_FragCoord.s - step, gl_FragCoord.t + step );
-	nCoord[6] = vec2( gl_FragCoord.s       , gl_FragCoord.t + step );
-	nCoord[7] = vec2( gl_FragCoord.s + step, gl_FragCoord.t + step );
+	fragSeedId = texelFetch( tex0, coord ).r;
 
-	fragData0  = texture2DRect( tex0, gl_FragCoord.st );
-	colorData0 = texture2DRect( tex1, gl_FragCoord.st );
+	if( fragSeedId != NO_SEED )
+		dist = SeedDistance( fragSeedId );
 
-	if( fragData0.a == 1.0 )
-		dist = (fragData0.r-gl_FragCoord.s)*(fragData0.r-gl_FragCoord.s) + (fragData0.g-gl_FragCoord.t)*(fragData0.g-gl_FragCoord.t);
-
-	for( i = 0; i < 8; ++i )
+	for( int i = 0; i < 8; ++i )
 	{
-		if( nCoord[i].s < 0.0 || nCoord[i].s >= width || nCoord[i].t < 0.0 || nCoord[i].t >= height )
+		ivec2 nCoord = coord + offsets[i] * s;
+
+#ifdef BORDER
+		if( nCoord.s < 0 || nCoord.s >= int( width ) || nCoord.t < 0 || nCoord.t >= int( height ) )
 			continue;
+#endif
 
-		neighbor0 = texture2DRect( tex0, nCoord[i] );
+		neighborSeedId = texelFetch( tex0, nCoord ).r;
 
-		if( neighbor0.a != 1.0 )
+		/* Neighbors mostly share our seed, which can't be any closer */
+		if( neighborSeedId == NO_SEED || neighborSeedId == fragSeedId )
 			continue;
 
-		newDist = (neighbor0.r-gl_FragCoord.s)*(neighbor0.r-gl_FragCoord.s) + (neighbor0.g-gl_FragCoord.t)*(neighbor0.g-gl_FragCoord.t);
+		newDist = SeedDistance( neighborSeedId );
 
-		if( fragData0.a != 1.0 || newDist < dist ) {
-			fragData0 = neighbor0;
-			colorData0 = texture2DRect( tex1, nCoord[i] );
+		if( fragSeedId == NO_SEED || newDist < dist ) {
+			fragSeedId = neighborSeedId;
 			dist = newDist;
 		}
 	}
 
-	gl_FragData[0] = fragData0;
-	gl_FragData[1] = colorData0;
+	fragSeedIdOut = fragSeedId;
 }
@@ -0,0 +1,10 @@
+#version 330 core
+
+uniform vec4 color; /* the markers' color */
+
+out vec4 fragColor;
+
+void main()
+{
+	fragColor = color;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+layout( location = 0 ) in vec2 position; /* seed position, from 0 to 1 */
+
+void main()
+{
+	gl_Position = vec4( position * 2.0 - 1.0, 0.0, 1.0 );
+}
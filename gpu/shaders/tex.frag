@@ -1,8 +1,18 @@
-#extension GL_ARB_texture_rectangle : enable
+#version 330 core
 
-uniform sampler2DRect tex; /* the texture to read from */
+#define NO_SEED 0xFFFFFFFFu
+
+uniform usampler2DRect tex; /* the texture to read from, with the index of each pixel's closest seed */
+uniform samplerBuffer colors; /* the seeds' colors */
+
+out vec4 fragColor;
 
 void main()
 {
-	gl_FragColor = texture2DRect( tex, gl_FragCoord.st );
+	uint seedId = texelFetch( tex, ivec2( gl_FragCoord.st ) ).r;
+
+	if( seedId == NO_SEED )
+		fragColor = vec4( 0.0, 0.0, 0.0, 1.0 );
+	else
+		fragColor = texelFetch( colors, int( seedId ) );
 }
@@ -1,4 +1,8 @@
+#version 330 core
+
+/* A single triangle covering the whole screen, with no vertex data */
 void main()
 {
-	gl_Position = ftransform();
+	vec2 corner = vec2( ( gl_VertexID << 1 ) & 2, gl_VertexID & 2 );
+	gl_Position = vec4( corner * 2.0 - 1.0, 0.0, 1.0 );
 }